@@ -4,9 +4,14 @@
  * contiguous.
  */
 #include "Array.h"
+#include "Intrinsics.h"
 
 #define MINIMUM_SIZE 32
 
+static uint64 Array_RoundAllocation(uint64 size);
+static uint8* Array_AllocateData(uint8 backing, uint64 allocation);
+static void Array_FreeData(Array* self);
+
 /**
  * Create a new array.
  *
@@ -22,6 +27,43 @@ Array* Array_New(uint64 size) {
 	return array;
 }
 
+/**
+ * Create a new array whose data is allocated with @a backing.
+ *
+ * @param size Size in bytes of new array
+ * @param backing One of the ARRAY_BACKING_* values
+ * @returns pointer to newly initialzed array
+ */
+Array* Array_NewWithBacking(uint64 size, uint8 backing) {
+	Array* array;
+
+	array = Allocate(Array);
+	Array_InitializeWithBacking(array, size, backing);
+
+	return array;
+}
+
+/**
+ * Create a new array backed directly by a file's pages. Nothing is read until
+ * it is accessed.
+ *
+ * @param path Path of the file to map
+ * @param mode One of the MEMORY_MAP_* values
+ * @returns pointer to newly created array, or NULL if the file could not be mapped
+ */
+Array* Array_MapFile(int8* path, uint8 mode) {
+	Array* array;
+
+	array = Allocate(Array);
+
+	if (!Array_InitializeMapped(array, path, mode)) {
+		Free(array);
+		array = NULL;
+	}
+
+	return array;
+}
+
 /**
  * Create a new array using data from an existing buffer.
  *
@@ -36,14 +78,13 @@ Array* Array_NewFromExisting(uint8* data, uint64 size) {
 	assert(size > 0);
 	assert(data != NULL);
 
-	actualSize = MINIMUM_SIZE;
-	while (actualSize < size)
-		actualSize *= 2;
+	actualSize = Array_RoundAllocation(size);
 
 	array = Allocate(Array);
 	array->Size = size;
 	array->Allocation = actualSize;
-	array->Data = AllocateArray(uint8, size);
+	array->Backing = ARRAY_BACKING_HEAP;
+	array->Data = AllocateArray(uint8, actualSize);
 
 	Memory_BlockCopy(data, array->Data, size);
 
@@ -57,17 +98,97 @@ Array* Array_NewFromExisting(uint8* data, uint64 size) {
  * @param size size of new array
  */
 void Array_Initialize(Array* array, uint64 size) {
+	Array_InitializeWithBacking(array, size, ARRAY_BACKING_HEAP);
+}
+
+/**
+ * Initialize an already allocated array whose data is allocated with @a backing.
+ *
+ * @param array array object to initialize
+ * @param size size of new array
+ * @param backing One of the ARRAY_BACKING_* values
+ */
+void Array_InitializeWithBacking(Array* array, uint64 size, uint8 backing) {
 	uint64 actualSize;
 
 	assert(array != NULL);
 
-	actualSize = MINIMUM_SIZE;
-	while (actualSize < size)
-		actualSize *= 2;
+	actualSize = Array_RoundAllocation(size);
 
 	array->Size = size;
 	array->Allocation = actualSize;
-	array->Data = AllocateArray(uint8, actualSize);
+	array->Backing = backing;
+	array->Data = Array_AllocateData(backing, actualSize);
+}
+
+/**
+ * Initialize an already allocated array with a mapping of a file. An empty file
+ * gives an empty array.
+ *
+ * @param array array object to initialize
+ * @param path Path of the file to map
+ * @param mode One of the MEMORY_MAP_* values
+ * @returns true if the file was mapped
+ */
+boolean Array_InitializeMapped(Array* array, int8* path, uint8 mode) {
+	void* data;
+	uint64 size;
+	boolean result;
+
+	assert(array != NULL);
+
+	result = Memory_MapFile(path, mode, &data, &size);
+
+	array->Data = (uint8*)data;
+	array->Size = size;
+	array->Allocation = size;
+	array->Backing = ARRAY_BACKING_FILE;
+
+	return result;
+}
+
+/**
+ * Initializes an array over bytes the caller owns, without copying them.
+ * Freeing the array leaves the bytes alone. Growing it past @a size copies
+ * the contents into memory the array owns, as with a file-mapped array.
+ *
+ * @param array Array to initialize
+ * @param data Bytes to use; must outlive the array or its next growth
+ * @param size Number of bytes at @a data
+ */
+void Array_InitializeBorrowed(Array* array, uint8* data, uint64 size) {
+	assert(array != NULL);
+	assert(data != NULL || size == 0);
+
+	array->Data = data;
+	array->Size = size;
+	array->Allocation = size;
+	array->Backing = ARRAY_BACKING_BORROWED;
+}
+
+/**
+ * Hint how a file-mapped array will be accessed.
+ *
+ * @param self Array to advise on
+ * @param advice One of the MEMORY_ADVICE_* values
+ */
+void Array_Advise(Array* self, uint8 advice) {
+	assert(self != NULL);
+
+	if (self->Backing == ARRAY_BACKING_FILE)
+		Memory_Advise(self->Data, self->Allocation, advice);
+}
+
+/**
+ * Write changes to a MEMORY_MAP_READWRITE file-mapped array back to the file.
+ *
+ * @param self Array to synchronize
+ */
+void Array_Sync(Array* self) {
+	assert(self != NULL);
+
+	if (self->Backing == ARRAY_BACKING_FILE)
+		Memory_SyncFile(self->Data, self->Allocation);
 }
 
 /**
@@ -89,28 +210,63 @@ void Array_Free(Array* self) {
 void Array_Uninitialize(Array* self) {
 	assert(self != NULL);
 
-	Free(self->Data);
+	Array_FreeData(self);
 	self->Size = 0;
 	self->Allocation = 0;
 }
 
 /**
- * Resize an array.
+ * Resize an array. Once an array reaches ARRAY_PAGES_THRESHOLD it moves into its
+ * own page mapping, after which growing it remaps pages instead of copying.
+ * A file-mapped or borrowed array that grows past the end of its bytes is
+ * copied into memory and no longer refers to them.
  *
  * @param self Array to resize
  * @param newSize Desired size of array
  */
 void Array_Resize(Array* self, uint64 newSize) {
 	uint64 actualSize;
+	uint8* data;
 
 	assert(newSize > 0);
 	assert(self != NULL);
 
-	actualSize = MINIMUM_SIZE;
-	while (actualSize < newSize)
-		actualSize *= 2;
+	if ((self->Backing == ARRAY_BACKING_FILE || self->Backing == ARRAY_BACKING_BORROWED) && newSize <= self->Allocation) {
+		self->Size = newSize;
+		return;
+	}
+
+	actualSize = Array_RoundAllocation(newSize);
+
+	if (actualSize != self->Allocation) {
+		if (self->Backing == ARRAY_BACKING_FILE || self->Backing == ARRAY_BACKING_BORROWED) {
+			data = Array_AllocateData(actualSize >= ARRAY_PAGES_THRESHOLD ? ARRAY_BACKING_PAGES : ARRAY_BACKING_HEAP, actualSize);
+			Memory_BlockCopy(self->Data, data, self->Size < newSize ? self->Size : newSize);
+			Array_FreeData(self);
+			self->Data = data;
+			self->Backing = actualSize >= ARRAY_PAGES_THRESHOLD ? ARRAY_BACKING_PAGES : ARRAY_BACKING_HEAP;
+		}
+		else if (self->Backing != ARRAY_BACKING_PAGES && actualSize >= ARRAY_PAGES_THRESHOLD) {
+			data = (uint8*)Memory_AllocatePages(actualSize);
+			Memory_BlockCopy(self->Data, data, self->Size < newSize ? self->Size : newSize);
+			Array_FreeData(self);
+			self->Data = data;
+			self->Backing = ARRAY_BACKING_PAGES;
+		}
+		else if (self->Backing == ARRAY_BACKING_PAGES) {
+			self->Data = (uint8*)Memory_ReallocatePages(self->Data, self->Allocation, actualSize);
+		}
+		else if (self->Backing == ARRAY_BACKING_HEAP) {
+			self->Data = ReallocateArray(uint8, actualSize, self->Data);
+		}
+		else {
+			data = Array_AllocateData(self->Backing, actualSize);
+			Memory_BlockCopy(self->Data, data, self->Size < newSize ? self->Size : newSize);
+			Array_FreeData(self);
+			self->Data = data;
+		}
+	}
 
-	if (actualSize != self->Allocation) self->Data = ReallocateArray(uint8, actualSize, self->Data);
 	self->Allocation = actualSize;
 	self->Size = newSize;
 }
@@ -175,3 +331,99 @@ void Array_Append(Array* self, Array* source) {
 	Array_Resize(self, self->Size + source->Size);
 	Array_Write(self, source->Data, self->Size, source->Size);
 }
+
+/**
+ * Borrow a range of an array without copying it.
+ *
+ * @param self Array to view
+ * @param position Offset (in bytes) from start of the array
+ * @param amount Number of bytes in the view
+ *
+ * @warning The view is invalidated by any resize of @a self.
+ */
+ArrayView Array_View(Array* self, uint64 position, uint64 amount) {
+	assert(self != NULL);
+	assert(position + amount <= self->Size);
+
+	return ArrayView_FromBytes(self->Data + position, amount);
+}
+
+/**
+ * Create a new array holding a copy of the bytes in a view.
+ *
+ * @param view Bytes to copy
+ * @returns pointer to newly created array
+ */
+Array* Array_NewFromView(ArrayView view) {
+	Array* array;
+
+	array = Array_New(view.Size);
+	Memory_BlockCopy(view.Data, array->Data, view.Size);
+
+	return array;
+}
+
+/**
+ * Write the bytes in a view to an array, resizing if needed.
+ *
+ * @param self Array to write to
+ * @param view Bytes to write
+ * @param position Offset (in bytes) from start of array to write to
+ */
+void Array_WriteView(Array* self, ArrayView view, uint64 position) {
+	Array_Write(self, view.Data, position, view.Size);
+}
+
+ArrayView ArrayView_FromBytes(uint8* data, uint64 size) {
+	ArrayView view;
+
+	assert(data != NULL || size == 0);
+
+	view.Data = data;
+	view.Size = size;
+
+	return view;
+}
+
+/**
+ * Narrow a view to a sub-range.
+ *
+ * @param view View to slice
+ * @param position Offset (in bytes) from the start of @a view
+ * @param amount Number of bytes in the slice
+ */
+ArrayView ArrayView_Slice(ArrayView view, uint64 position, uint64 amount) {
+	assert(position + amount <= view.Size);
+
+	return ArrayView_FromBytes(view.Data + position, amount);
+}
+
+boolean ArrayView_Equals(ArrayView a, ArrayView b) {
+	return Memory_Compare(a.Data, b.Data, a.Size, b.Size);
+}
+
+/* the smallest power of two, at least MINIMUM_SIZE, that holds size bytes */
+static uint64 Array_RoundAllocation(uint64 size) {
+	if (size <= MINIMUM_SIZE)
+		return MINIMUM_SIZE;
+
+	return (uint64)1 << (64 - CountLeadingZeros64(size - 1));
+}
+
+static uint8* Array_AllocateData(uint8 backing, uint64 allocation) {
+	switch (backing) {
+		case ARRAY_BACKING_ALIGNED: return AllocateArrayAligned(uint8, allocation, ARRAY_ALIGNMENT);
+		case ARRAY_BACKING_PAGES: return (uint8*)Memory_AllocatePages(allocation);
+		default: return AllocateArray(uint8, allocation);
+	}
+}
+
+static void Array_FreeData(Array* self) {
+	switch (self->Backing) {
+		case ARRAY_BACKING_ALIGNED: FreeAligned(self->Data); break;
+		case ARRAY_BACKING_PAGES: Memory_FreePages(self->Data, self->Allocation); break;
+		case ARRAY_BACKING_FILE: Memory_UnmapFile(self->Data, self->Allocation); break;
+		case ARRAY_BACKING_BORROWED: break;
+		default: Free(self->Data); break;
+	}
+}
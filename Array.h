@@ -3,15 +3,37 @@
 
 #include "Common.h"
 
+/* where an array's data lives */
+#define ARRAY_BACKING_HEAP 0
+#define ARRAY_BACKING_ALIGNED 1 /* aligned to ARRAY_ALIGNMENT for vector kernels */
+#define ARRAY_BACKING_PAGES 2 /* mapped directly from the OS, huge pages once large enough */
+#define ARRAY_BACKING_FILE 3 /* a mapping of a file, see Array_MapFile */
+#define ARRAY_BACKING_BORROWED 4 /* bytes owned by the caller, see Array_InitializeBorrowed; never freed */
+
+#define ARRAY_ALIGNMENT 64
+#define ARRAY_PAGES_THRESHOLD MEMORY_HUGEPAGE_SIZE /* arrays that grow this large move to ARRAY_BACKING_PAGES */
+
 typedef struct {
     uint8* Data;
     uint64 Size;
     uint64 Allocation;
+    uint8 Backing;
 } Array;
 
+/* A borrowed, non-owning window onto bytes owned by someone else. Passed by value and never freed. */
+typedef struct {
+    uint8* Data;
+    uint64 Size;
+} ArrayView;
+
 export Array* Array_New(uint64 size);
+export Array* Array_NewWithBacking(uint64 size, uint8 backing);
 export Array* Array_NewFromExisting(uint8* data, uint64 size);
+export Array* Array_MapFile(int8* path, uint8 mode);
 export void Array_Initialize(Array* array, uint64 size);
+export void Array_InitializeWithBacking(Array* array, uint64 size, uint8 backing);
+export boolean Array_InitializeMapped(Array* array, int8* path, uint8 mode);
+export void Array_InitializeBorrowed(Array* array, uint8* data, uint64 size);
 export void Array_Free(Array* self);
 export void Array_Uninitialize(Array* self);
 
@@ -20,5 +42,15 @@ export uint8* Array_Read(Array* self, uint64 position, uint64 amount);
 export void Array_ReadTo(Array* self, uint64 position, uint64 amount, uint8* targetBuffer);
 export void Array_Write(Array* self, uint8* data, uint64 position, uint64 amount);
 export void Array_Append(Array* self, Array* source);
+export void Array_Advise(Array* self, uint8 advice);
+export void Array_Sync(Array* self);
+
+export ArrayView Array_View(Array* self, uint64 position, uint64 amount);
+export Array* Array_NewFromView(ArrayView view);
+export void Array_WriteView(Array* self, ArrayView view, uint64 position);
+
+export ArrayView ArrayView_FromBytes(uint8* data, uint64 size);
+export ArrayView ArrayView_Slice(ArrayView view, uint64 position, uint64 amount);
+export boolean ArrayView_Equals(ArrayView a, ArrayView b);
 
 #endif
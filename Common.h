@@ -9,6 +9,10 @@
 	#define export __attribute__((visibility ("default")))
 #endif
 
+#if defined WINDOWS && !defined __cplusplus
+	#define inline __inline
+#endif
+
 #define true 1
 #define false 0
 #define NULL 0
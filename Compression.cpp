@@ -0,0 +1,352 @@
+#include "Compression.h"
+#include "Intrinsics.h"
+
+#include <string.h>
+
+/*
+ * Blocks use the LZ4 block format: a series of sequences, each a run of
+ * literal bytes followed by a copy of earlier output. A sequence starts with
+ * a token byte holding the literal length in its high four bits and the match
+ * length less COMPRESSION_MIN_MATCH in its low four; a field of 15 continues
+ * in following bytes of 255 until one below it. Then come the literals, the
+ * match offset as two little-endian bytes and any match length continuation.
+ * The last sequence has only literals.
+ */
+
+#define COMPRESSION_MIN_MATCH 4
+#define COMPRESSION_LAST_LITERALS 5 /* the last bytes of a block are always literals */
+#define COMPRESSION_MATCH_LIMIT 12 /* no match starts within this many bytes of the end */
+#define COMPRESSION_MAX_OFFSET 65535
+#define COMPRESSION_HASH_BITS 16
+#define COMPRESSION_CHAIN_SIZE 65536 /* one entry per position in the window, indexed by position modulo the size */
+#define COMPRESSION_EMPTY 0xFFFFFFFF
+
+static uint32 Compression_Read32(uint8* data) {
+	uint32 value;
+
+	memcpy(&value, data, sizeof(value));
+
+	return value;
+}
+
+static uint32 Compression_Hash(uint8* data) {
+	return (Compression_Read32(data) * 2654435761U) >> (32 - COMPRESSION_HASH_BITS);
+}
+
+/* Counts the bytes at a and b that agree, a word at a time, up to limit for a. */
+static uint64 Compression_MatchLength(uint8* a, uint8* b, uint8* limit) {
+	uint8* start;
+#ifdef INTRINSICS_LITTLE_ENDIAN
+	uint64 x;
+	uint64 y;
+#endif
+
+	start = a;
+
+#ifdef INTRINSICS_LITTLE_ENDIAN
+	while (a + 8 <= limit) {
+		memcpy(&x, a, sizeof(x));
+		memcpy(&y, b, sizeof(y));
+
+		if (x != y)
+			return (uint64)(a - start) + CountTrailingZeros64(x ^ y) / 8;
+
+		a += 8;
+		b += 8;
+	}
+#endif
+
+	while (a < limit && *a == *b) {
+		a++;
+		b++;
+	}
+
+	return (uint64)(a - start);
+}
+
+/* Writes the remainder of a length field that overflowed its four bits. Returns the new end. */
+static uint8* Compression_WriteLength(uint8* output, uint64 length) {
+	for (; length >= 255; length -= 255)
+		*output++ = 255;
+
+	*output++ = (uint8)length;
+
+	return output;
+}
+
+/* Bytes needed for a sequence, or the final literals when matchLength is 0. */
+static uint64 Compression_SequenceSize(uint64 literalLength, uint64 matchLength) {
+	uint64 size;
+
+	size = 1 + literalLength + (literalLength >= 15 ? (literalLength - 15) / 255 + 1 : 0);
+
+	if (matchLength > 0)
+		size += 2 + (matchLength - COMPRESSION_MIN_MATCH >= 15 ? (matchLength - COMPRESSION_MIN_MATCH - 15) / 255 + 1 : 0);
+
+	return size;
+}
+
+static uint8* Compression_WriteSequence(uint8* output, uint8* literals, uint64 literalLength, uint64 offset, uint64 matchLength) {
+	uint8* token;
+
+	token = output++;
+	*token = (uint8)((literalLength >= 15 ? 15 : literalLength) << 4);
+
+	if (literalLength >= 15)
+		output = Compression_WriteLength(output, literalLength - 15);
+
+	memcpy(output, literals, (size_t)literalLength);
+	output += literalLength;
+
+	if (matchLength == 0)
+		return output;
+
+	*output++ = (uint8)offset;
+	*output++ = (uint8)(offset >> 8);
+
+	matchLength -= COMPRESSION_MIN_MATCH;
+	*token |= (uint8)(matchLength >= 15 ? 15 : matchLength);
+
+	if (matchLength >= 15)
+		output = Compression_WriteLength(output, matchLength - 15);
+
+	return output;
+}
+
+/* The most a block of @a length bytes can compress to, when none of it matches. */
+uint64 Compression_Bound(uint64 length) {
+	return length + length / 255 + 16;
+}
+
+/**
+ * Compresses @a source as one block in the LZ4 block format. Matches are
+ * found with hash chains: every position is filed under a hash of its first
+ * four bytes, and up to @a level earlier positions with the same hash within
+ * the last 64 KiB are compared, keeping the longest match.
+ *
+ * @param capacity bytes available at @a destination; Compression_Bound of the
+ * source size is always enough
+ * @param level one of the COMPRESSION_LEVEL_* values, or any count of
+ * attempts per position
+ * @returns the compressed size, or 0 if it would exceed @a capacity
+ */
+uint64 Compression_Compress(ArrayView source, uint8* destination, uint64 capacity, uint32 level) {
+	uint32* heads;
+	uint16* chain;
+	uint8* input;
+	uint8* output;
+	uint8* outputEnd;
+	uint8* matchLimit;
+	uint64 length;
+	uint64 position;
+	uint64 anchor;
+	uint64 inserted;
+	uint64 candidate;
+	uint64 bestLength;
+	uint64 bestOffset;
+	uint64 matchLength;
+	uint32 hash;
+	uint32 attempts;
+	uint16 step;
+
+	assert(source.Data != NULL || source.Size == 0);
+	assert(destination != NULL);
+	assert(source.Size < COMPRESSION_EMPTY);
+
+	input = source.Data;
+	length = source.Size;
+	output = destination;
+	outputEnd = destination + capacity;
+	anchor = 0;
+
+	if (length > COMPRESSION_MATCH_LIMIT) {
+		heads = AllocateArray(uint32, 1 << COMPRESSION_HASH_BITS);
+		chain = AllocateArray(uint16, COMPRESSION_CHAIN_SIZE);
+		memset(heads, 0xFF, sizeof(uint32) << COMPRESSION_HASH_BITS);
+
+		matchLimit = input + length - COMPRESSION_LAST_LITERALS;
+		inserted = 0;
+		position = 0;
+
+		while (position + COMPRESSION_MATCH_LIMIT < length) {
+			/* file every position up to this one, including those inside the last match */
+			for (; inserted <= position; inserted++) {
+				hash = Compression_Hash(input + inserted);
+				candidate = heads[hash];
+				chain[inserted % COMPRESSION_CHAIN_SIZE] = (uint16)(candidate == COMPRESSION_EMPTY || inserted - candidate > COMPRESSION_MAX_OFFSET ? 0 : inserted - candidate);
+				heads[hash] = (uint32)inserted;
+			}
+
+			bestLength = 0;
+			bestOffset = 0;
+			candidate = position;
+
+			for (attempts = level; attempts > 0; attempts--) {
+				step = chain[candidate % COMPRESSION_CHAIN_SIZE];
+				if (step == 0 || position - (candidate - step) > COMPRESSION_MAX_OFFSET)
+					break;
+
+				candidate -= step;
+
+				if (Compression_Read32(input + candidate) == Compression_Read32(input + position)) {
+					matchLength = COMPRESSION_MIN_MATCH + Compression_MatchLength(input + position + COMPRESSION_MIN_MATCH, input + candidate + COMPRESSION_MIN_MATCH, matchLimit);
+
+					if (matchLength > bestLength) {
+						bestLength = matchLength;
+						bestOffset = position - candidate;
+
+						if (input + position + matchLength == matchLimit)
+							break;
+					}
+				}
+			}
+
+			if (bestLength == 0) {
+				position++;
+				continue;
+			}
+
+			if (Compression_SequenceSize(position - anchor, bestLength) > (uint64)(outputEnd - output)) {
+				output = NULL;
+				break;
+			}
+
+			output = Compression_WriteSequence(output, input + anchor, position - anchor, bestOffset, bestLength);
+			position += bestLength;
+			anchor = position;
+		}
+
+		Free(heads);
+		Free(chain);
+
+		if (output == NULL)
+			return 0;
+	}
+
+	if (Compression_SequenceSize(length - anchor, 0) > (uint64)(outputEnd - output))
+		return 0;
+
+	output = Compression_WriteSequence(output, input + anchor, length - anchor, 0, 0);
+
+	return (uint64)(output - destination);
+}
+
+/* Reads the continuation of a length field. Returns false if it runs off the end of the input. */
+static boolean Compression_ReadLength(uint8** input, uint8* inputEnd, uint64* length) {
+	uint8 byte;
+
+	do {
+		if (*input == inputEnd)
+			return false;
+
+		byte = *(*input)++;
+		*length += byte;
+	} while (byte == 255);
+
+	return true;
+}
+
+/**
+ * Decompresses one block written by Compression_Compress, or by any LZ4 block
+ * compressor. Every length and offset is checked, so malformed input is
+ * reported rather than read or written out of bounds.
+ *
+ * @returns the decompressed size, or COMPRESSION_ERROR if the block is
+ * malformed or decompresses to more than @a capacity bytes
+ */
+uint64 Compression_Decompress(ArrayView source, uint8* destination, uint64 capacity) {
+	uint8* input;
+	uint8* inputEnd;
+	uint8* output;
+	uint8* outputEnd;
+	uint8* match;
+	uint8* end;
+	uint64 literalLength;
+	uint64 matchLength;
+	uint64 offset;
+	uint8 token;
+
+	assert(source.Data != NULL || source.Size == 0);
+	assert(destination != NULL || capacity == 0);
+
+	input = source.Data;
+	inputEnd = source.Data + source.Size;
+	output = destination;
+	outputEnd = destination + capacity;
+
+	if (source.Size == 0)
+		return COMPRESSION_ERROR;
+
+	for (;;) {
+		if (input == inputEnd)
+			return COMPRESSION_ERROR;
+
+		token = *input++;
+		literalLength = token >> 4;
+
+		if (literalLength == 15 && !Compression_ReadLength(&input, inputEnd, &literalLength))
+			return COMPRESSION_ERROR;
+
+		/* short runs away from either end are copied in two fixed 16 byte moves, overshooting into space that is written next anyway */
+		if (literalLength <= 32 && inputEnd - input >= 32 && outputEnd - output >= 32) {
+			memcpy(output, input, 16);
+			memcpy(output + 16, input + 16, 16);
+		}
+		else if (literalLength > (uint64)(inputEnd - input) || literalLength > (uint64)(outputEnd - output)) {
+			return COMPRESSION_ERROR;
+		}
+		else {
+			memcpy(output, input, (size_t)literalLength);
+		}
+
+		input += literalLength;
+		output += literalLength;
+
+		/* the last sequence ends with its literals */
+		if (input == inputEnd)
+			break;
+
+		if (inputEnd - input < 2)
+			return COMPRESSION_ERROR;
+
+		offset = input[0] | (uint64)input[1] << 8;
+		input += 2;
+
+		if (offset == 0 || offset > (uint64)(output - destination))
+			return COMPRESSION_ERROR;
+
+		matchLength = token & 15;
+
+		if (matchLength == 15 && !Compression_ReadLength(&input, inputEnd, &matchLength))
+			return COMPRESSION_ERROR;
+
+		matchLength += COMPRESSION_MIN_MATCH;
+
+		if (matchLength > (uint64)(outputEnd - output))
+			return COMPRESSION_ERROR;
+
+		match = output - offset;
+		end = output + matchLength;
+
+		/*
+		 * A match may overlap the bytes it produces, repeating them. One at
+		 * least 8 back can still be copied 8 bytes at a time, each word
+		 * coming from bytes already written.
+		 */
+		if (offset >= 8 && (uint64)(outputEnd - output) >= matchLength + 8) {
+			do {
+				memcpy(output, match, 8);
+				output += 8;
+				match += 8;
+			} while (output < end);
+		}
+		else {
+			while (output < end)
+				*output++ = *match++;
+		}
+
+		output = end;
+	}
+
+	return (uint64)(output - destination);
+}
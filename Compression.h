@@ -0,0 +1,19 @@
+#ifndef INCLUDE_UTILITIES_COMPRESSION
+#define INCLUDE_UTILITIES_COMPRESSION
+
+#include "Common.h"
+#include "Array.h"
+
+/* how many earlier occurrences the match finder tries per position: more find longer matches, more slowly */
+#define COMPRESSION_LEVEL_FAST 1
+#define COMPRESSION_LEVEL_DEFAULT 16
+#define COMPRESSION_LEVEL_HIGH 256
+
+#define COMPRESSION_ERROR 0xFFFFFFFFFFFFFFFFULL
+#define COMPRESSION_BLOCK_SIZE 262144 /* bytes per block of a frame written by DataStream_Compress */
+
+export uint64 Compression_Bound(uint64 length);
+export uint64 Compression_Compress(ArrayView source, uint8* destination, uint64 capacity, uint32 level);
+export uint64 Compression_Decompress(ArrayView source, uint8* destination, uint64 capacity);
+
+#endif
@@ -1,4 +1,32 @@
+/* for O_DIRECT */
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE
+#endif
+
 #include "DataStream.h"
+#include "Intrinsics.h"
+
+#include <string.h>
+
+#ifdef WINDOWS
+	#include <io.h>
+	#include <fcntl.h>
+	#include <sys/stat.h>
+#else
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#define DATASTREAM_VARINT_MAX 10 /* bytes needed to encode any uint64 seven bits at a time */
+#define DATASTREAM_PACKED_BLOCK 64 /* values per block of a packed array */
+#define DATASTREAM_FRAME_MAGIC 0x3146534C /* "LSF1" as little-endian bytes, at the start of a compressed frame */
+#define DATASTREAM_FRAME_STORED 0x80000000 /* set in a block's compressed size when it is stored as is */
+#define DATASTREAM_FILE_DIRECT 0x80 /* set in FileMode while O_DIRECT is in effect, so transfers must be whole aligned blocks */
+
+static void DataStream_InitializeFields(DataStream* dataStream);
+static void DataStream_EndDirect(DataStream* self);
+static boolean DataStream_Fill(DataStream* self, uint64 count);
+static boolean DataStream_DecodeVarUInt(DataStream* self, uint64* value);
 
 DataStream* DataStream_New(uint64 allocation) {
 	DataStream* dataStream;
@@ -9,6 +37,45 @@ DataStream* DataStream_New(uint64 allocation) {
 	return dataStream;
 }
 
+/* Opens a stream over a memory-mapped file (see Array_MapFile). Reads decode the file in place; a stream opened with MEMORY_MAP_READONLY must not be written to. Returns NULL if the file could not be mapped. */
+DataStream* DataStream_OpenMapped(int8* path, uint8 mode) {
+	DataStream* dataStream;
+
+	dataStream = Allocate(DataStream);
+	DataStream_InitializeFields(dataStream);
+
+	if (!Array_InitializeMapped(&dataStream->Data, path, mode)) {
+		Free(dataStream);
+		dataStream = NULL;
+	}
+
+	return dataStream;
+}
+
+/* Wraps bytes the caller owns, such as a received message, so they can be decoded in place. See DataStream_InitializeWrapped. */
+DataStream* DataStream_Wrap(uint8* data, uint64 length) {
+	DataStream* dataStream;
+
+	dataStream = Allocate(DataStream);
+	DataStream_InitializeWrapped(dataStream, data, length);
+
+	return dataStream;
+}
+
+/**
+ * Initializes a stream over @a length bytes at @a data for reading without
+ * copying them. The caller keeps ownership: uninitializing the stream does
+ * not free them, and they must outlive the stream and any views read from it.
+ * The bytes are never written; the first write to the stream moves it onto a
+ * copy of them instead.
+ */
+void DataStream_InitializeWrapped(DataStream* dataStream, uint8* data, uint64 length) {
+	assert(dataStream != NULL);
+
+	DataStream_InitializeFields(dataStream);
+	Array_InitializeBorrowed(&dataStream->Data, data, length);
+}
+
 void DataStream_Initialize(DataStream* dataStream, uint64 allocation) {
 	uint64 actualSize;
 
@@ -18,9 +85,103 @@ void DataStream_Initialize(DataStream* dataStream, uint64 allocation) {
 	while (actualSize < allocation)
 		actualSize *= 2;
 
+	DataStream_InitializeFields(dataStream);
+	Array_Initialize(&dataStream->Data, actualSize);
+}
+
+static void DataStream_InitializeFields(DataStream* dataStream) {
 	dataStream->Cursor = 0;
 	dataStream->IsEOF = false;
-	Array_Initialize(&dataStream->Data, actualSize);
+	dataStream->ByteOrder = DATASTREAM_BYTEORDER_HOST;
+	dataStream->IsSwapped = false;
+	dataStream->File = -1;
+	dataStream->FileMode = 0;
+	dataStream->FileOffset = 0;
+}
+
+/**
+ * Opens a stream that reads or writes a file through a fixed-size window
+ * instead of holding it all in memory. See DataStream_InitializeFile.
+ *
+ * @returns NULL if the file could not be opened
+ */
+DataStream* DataStream_OpenFile(int8* path, uint8 mode) {
+	DataStream* dataStream;
+
+	dataStream = Allocate(DataStream);
+
+	if (!DataStream_InitializeFile(dataStream, path, mode)) {
+		Free(dataStream);
+		dataStream = NULL;
+	}
+
+	return dataStream;
+}
+
+/**
+ * Initializes a stream over a file, buffered through a window of
+ * DATASTREAM_FILE_WINDOW bytes. A reading stream refills the window as the
+ * cursor reaches its end; a writing stream flushes it to the file as it fills
+ * and when the stream is uninitialized. The Read and Write functions work as
+ * they do on memory streams, with these differences:
+ *
+ * - the cursor is relative to the window; Seek takes a position in the file
+ * - views and byte pointers read from the stream stay valid only until the
+ *   next read, which may move the window
+ * - the window grows to fit any single value, view or string larger than it
+ * - a failed write sets IsEOF, as a failed read does
+ *
+ * @param mode DATASTREAM_FILE_READ or DATASTREAM_FILE_WRITE, optionally
+ * combined with DATASTREAM_FILE_UNCACHED
+ * @returns false if the file could not be opened
+ */
+boolean DataStream_InitializeFile(DataStream* dataStream, int8* path, uint8 mode) {
+	int32 flags;
+	int32 file;
+
+	assert(dataStream != NULL);
+	assert(path != NULL);
+
+	DataStream_InitializeFields(dataStream);
+
+#ifdef WINDOWS
+	flags = (mode & DATASTREAM_FILE_WRITE ? _O_WRONLY | _O_CREAT | _O_TRUNC : _O_RDONLY) | _O_BINARY | _O_SEQUENTIAL;
+	file = _open(path, flags, _S_IREAD | _S_IWRITE);
+#else
+	flags = mode & DATASTREAM_FILE_WRITE ? O_WRONLY | O_CREAT | O_TRUNC : O_RDONLY;
+	file = -1;
+
+	#ifdef O_DIRECT
+		/* not every file system accepts O_DIRECT; those that refuse fall back to dropping pages with posix_fadvise */
+		if (mode & DATASTREAM_FILE_UNCACHED) {
+			file = open(path, flags | O_DIRECT, 0644);
+
+			if (file >= 0)
+				mode |= DATASTREAM_FILE_DIRECT;
+		}
+	#endif
+
+	if (file < 0)
+		file = open(path, flags, 0644);
+#endif
+
+	if (file < 0)
+		return false;
+
+#if !defined WINDOWS && defined POSIX_FADV_SEQUENTIAL
+	posix_fadvise(file, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+	/* page backed, so the window is aligned as O_DIRECT requires */
+	Array_InitializeWithBacking(&dataStream->Data, DATASTREAM_FILE_WINDOW, ARRAY_BACKING_PAGES);
+
+	dataStream->File = file;
+	dataStream->FileMode = mode;
+
+	if ((mode & DATASTREAM_FILE_WRITE) == 0)
+		dataStream->Data.Size = 0;
+
+	return true;
 }
 
 void DataStream_Free(DataStream* self) {
@@ -31,68 +192,364 @@ void DataStream_Free(DataStream* self) {
 void DataStream_Uninitialize(DataStream* self) {
 	assert(self != NULL);
 
+	if (self->File >= 0) {
+		if (self->FileMode & DATASTREAM_FILE_WRITE)
+			DataStream_Flush(self);
+
+#ifdef WINDOWS
+		_close(self->File);
+#else
+		close(self->File);
+#endif
+
+		self->File = -1;
+	}
+
 	Array_Uninitialize(&self->Data);
 	self->Cursor = 0;
 	self->IsEOF = true;
 }
 
 void DataStream_Seek(DataStream* self, uint64 position) {
-	assert(self != NULL);
+	uint64 base;
 
-	if (position >= self->Data.Size)
-		self->Cursor = self->Data.Size - 1;
-	else
-		self->Cursor = position;
+	assert(self != NULL);
 
 	self->IsEOF = false;
+
+	if (self->File < 0) {
+		if (position >= self->Data.Size)
+			self->Cursor = self->Data.Size > 0 ? self->Data.Size - 1 : 0;
+		else
+			self->Cursor = position;
+
+		return;
+	}
+
+	if (self->FileMode & DATASTREAM_FILE_WRITE) {
+		DataStream_Flush(self);
+		base = position;
+
+		if (position % DATASTREAM_FILE_ALIGNMENT != 0)
+			DataStream_EndDirect(self);
+	}
+	else if (position >= self->FileOffset && position - self->FileOffset <= self->Data.Size) {
+		self->Cursor = position - self->FileOffset;
+		return;
+	}
+	else {
+		base = self->FileMode & DATASTREAM_FILE_DIRECT ? position & ~(uint64)(DATASTREAM_FILE_ALIGNMENT - 1) : position;
+		self->Data.Size = 0;
+	}
+
+#ifdef WINDOWS
+	if (_lseeki64(self->File, (int64)base, SEEK_SET) < 0)
+#else
+	if (lseek(self->File, (off_t)base, SEEK_SET) < 0)
+#endif
+		self->IsEOF = true;
+
+	self->FileOffset = base;
+	self->Cursor = 0;
+
+	/* a reading stream loads the bytes between the aligned base and the position, so the cursor never passes the end of the window */
+	if (position > base && !DataStream_Fill(self, position - base))
+		self->IsEOF = true;
+
+	self->Cursor = position - base <= self->Data.Size ? position - base : self->Data.Size;
+}
+
+/* Calls read until count bytes arrive or the file ends. Returns the number of bytes read. */
+static uint64 DataStream_ReadFile(int32 file, uint8* buffer, uint64 count) {
+	uint64 done;
+	int64 result;
+
+	for (done = 0; done < count; done += (uint64)result) {
+#ifdef WINDOWS
+		result = _read(file, buffer + done, (uint32)(count - done > 0x40000000 ? 0x40000000 : count - done));
+#else
+		result = read(file, buffer + done, (size_t)(count - done));
+#endif
+
+		if (result <= 0)
+			break;
+	}
+
+	return done;
+}
+
+/* Calls write until all count bytes are written. Returns false on an error. */
+static boolean DataStream_WriteFile(int32 file, uint8* buffer, uint64 count) {
+	uint64 done;
+	int64 result;
+
+	for (done = 0; done < count; done += (uint64)result) {
+#ifdef WINDOWS
+		result = _write(file, buffer + done, (uint32)(count - done > 0x40000000 ? 0x40000000 : count - done));
+#else
+		result = write(file, buffer + done, (size_t)(count - done));
+#endif
+
+		if (result <= 0)
+			return false;
+	}
+
+	return true;
+}
+
+/* Asks the system to drop a range of the file from its cache, for streams opened with DATASTREAM_FILE_UNCACHED that could not use O_DIRECT. */
+static void DataStream_DropCache(DataStream* self, uint64 offset, uint64 length) {
+#if !defined WINDOWS && defined POSIX_FADV_DONTNEED
+	if ((self->FileMode & (DATASTREAM_FILE_UNCACHED | DATASTREAM_FILE_DIRECT)) == DATASTREAM_FILE_UNCACHED && length > 0)
+		posix_fadvise(self->File, (off_t)offset, (off_t)length, POSIX_FADV_DONTNEED);
+#endif
+}
+
+/* Turns O_DIRECT off, before a transfer that is not a whole number of aligned blocks. */
+static void DataStream_EndDirect(DataStream* self) {
+#ifdef O_DIRECT
+	if (self->FileMode & DATASTREAM_FILE_DIRECT)
+		fcntl(self->File, F_SETFL, fcntl(self->File, F_GETFL) & ~O_DIRECT);
+#endif
+
+	self->FileMode &= ~DATASTREAM_FILE_DIRECT;
+}
+
+/*
+ * Writes the first length bytes of the window to the file and moves the rest
+ * to the front. With O_DIRECT, only whole blocks are written unless all is
+ * set, in which case O_DIRECT is turned off first if the tail is partial.
+ */
+static boolean DataStream_Drain(DataStream* self, boolean all) {
+	uint64 length;
+
+	length = self->Cursor;
+
+	if (self->FileMode & DATASTREAM_FILE_DIRECT) {
+		if (!all) {
+			length &= ~(uint64)(DATASTREAM_FILE_ALIGNMENT - 1);
+		}
+		else if (length % DATASTREAM_FILE_ALIGNMENT != 0) {
+			DataStream_EndDirect(self);
+		}
+	}
+
+	if (length == 0)
+		return true;
+
+	if (!DataStream_WriteFile(self->File, self->Data.Data, length)) {
+		self->IsEOF = true;
+		return false;
+	}
+
+	DataStream_DropCache(self, self->FileOffset, length);
+
+	memmove(self->Data.Data, self->Data.Data + length, (size_t)(self->Cursor - length));
+	self->Cursor -= length;
+	self->FileOffset += length;
+
+	return true;
+}
+
+/**
+ * Writes everything buffered in a writing file stream to its file. On a
+ * stream using O_DIRECT, a tail that is not a whole block turns O_DIRECT off
+ * for the rest of the stream. Called by DataStream_Uninitialize; call it
+ * first to find out whether the writes succeeded.
+ *
+ * @returns false if a write failed
+ */
+boolean DataStream_Flush(DataStream* self) {
+	assert(self != NULL);
+
+	if (self->File < 0 || (self->FileMode & DATASTREAM_FILE_WRITE) == 0)
+		return true;
+
+	return DataStream_Drain(self, true) && !self->IsEOF;
+}
+
+/*
+ * Makes count bytes available to read at the cursor. A reading file stream
+ * drops the bytes before the cursor (back to a block boundary with O_DIRECT)
+ * and refills the window from the file, growing it if count does not fit.
+ * Callers that may rewind must do so before calling this.
+ */
+static boolean DataStream_Fill(DataStream* self, uint64 count) {
+	uint64 shift;
+	uint64 size;
+
+	/* a cursor past the end has nothing to keep; the sizes below would wrap */
+	if (self->Cursor > self->Data.Size)
+		return false;
+
+	if (count <= self->Data.Size - self->Cursor)
+		return true;
+
+	if (self->File < 0 || (self->FileMode & DATASTREAM_FILE_WRITE))
+		return false;
+
+	shift = self->FileMode & DATASTREAM_FILE_DIRECT ? self->Cursor & ~(uint64)(DATASTREAM_FILE_ALIGNMENT - 1) : self->Cursor;
+
+	if (shift > 0) {
+		memmove(self->Data.Data, self->Data.Data + shift, (size_t)(self->Data.Size - shift));
+		DataStream_DropCache(self, self->FileOffset, shift);
+
+		self->Data.Size -= shift;
+		self->Cursor -= shift;
+		self->FileOffset += shift;
+	}
+
+	if (self->Cursor + count > self->Data.Allocation) {
+		size = self->Data.Size;
+		Array_Resize(&self->Data, self->Cursor + count);
+		self->Data.Size = size;
+	}
+
+	self->Data.Size += DataStream_ReadFile(self->File, self->Data.Data + self->Data.Size, self->Data.Allocation - self->Data.Size);
+
+	return count <= self->Data.Size - self->Cursor;
+}
+
+/* Makes room to write up to count bytes at the cursor and returns how many fit: all of them in a memory stream, at least one in a file stream. */
+static uint64 DataStream_Room(DataStream* self, uint64 count) {
+	if (self->File < 0) {
+		DataStream_Reserve(self, count);
+		return count;
+	}
+
+	if (count > self->Data.Size - self->Cursor)
+		DataStream_Drain(self, false);
+
+	if (self->Data.Size == self->Cursor)
+		DataStream_Reserve(self, 1);
+
+	return count < self->Data.Size - self->Cursor ? count : self->Data.Size - self->Cursor;
+}
+
+/**
+ * Sets the byte order multi-byte values are written and read in from here
+ * on: DATASTREAM_BYTEORDER_HOST (the default), DATASTREAM_BYTEORDER_LITTLE or
+ * DATASTREAM_BYTEORDER_BIG. Byte arrays, strings and varints are unaffected.
+ */
+void DataStream_SetByteOrder(DataStream* self, uint8 byteOrder) {
+	assert(self != NULL);
+	assert(byteOrder <= DATASTREAM_BYTEORDER_BIG);
+
+	self->ByteOrder = byteOrder;
+
+#ifdef INTRINSICS_LITTLE_ENDIAN
+	self->IsSwapped = byteOrder == DATASTREAM_BYTEORDER_BIG;
+#else
+	self->IsSwapped = byteOrder == DATASTREAM_BYTEORDER_LITTLE;
+#endif
+}
+
+/**
+ * Makes room for @a count bytes at the cursor, growing the stream if needed,
+ * so that that many bytes of DataStream_Put* calls can follow unchecked. A
+ * file stream flushes its window first.
+ */
+void DataStream_Reserve(DataStream* self, uint64 count) {
+	Array copy;
+
+	assert(self != NULL);
+
+	/* a wrapped stream writes to a copy of the caller's bytes, never to the bytes themselves */
+	if (self->Data.Backing == ARRAY_BACKING_BORROWED) {
+		Array_Initialize(&copy, self->Cursor + count > self->Data.Size ? self->Cursor + count : self->Data.Size);
+		Memory_BlockCopy(self->Data.Data, copy.Data, self->Data.Size);
+		self->Data = copy;
+		return;
+	}
+
+	if (count <= self->Data.Size - self->Cursor)
+		return;
+
+	if (self->File >= 0 && DataStream_Drain(self, false) && count <= self->Data.Size - self->Cursor)
+		return;
+
+	Array_Resize(&self->Data, self->Cursor + count);
+
+	if (self->File >= 0)
+		self->Data.Size = self->Data.Allocation;
+}
+
+/* Stores size bytes at the cursor without the round trip through Array_Write. */
+static void DataStream_WriteFixed(DataStream* self, void* data, uint8 size) {
+	DataStream_Reserve(self, size);
+
+	memcpy(self->Data.Data + self->Cursor, data, size);
+	self->Cursor += size;
 }
 
 void DataStream_WriteUInt8(DataStream* self, uint8 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	DataStream_WriteFixed(self, &data, sizeof(data));
 }
 
 void DataStream_WriteUInt16(DataStream* self, uint16 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	if (self->IsSwapped)
+		data = ByteSwap16(data);
+
+	DataStream_WriteFixed(self, &data, sizeof(data));
 }
 
 void DataStream_WriteUInt32(DataStream* self, uint32 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	if (self->IsSwapped)
+		data = ByteSwap32(data);
+
+	DataStream_WriteFixed(self, &data, sizeof(data));
 }
 
 void DataStream_WriteUInt64(DataStream* self, uint64 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	if (self->IsSwapped)
+		data = ByteSwap64(data);
+
+	DataStream_WriteFixed(self, &data, sizeof(data));
 }
 
 void DataStream_WriteInt8(DataStream* self, int8 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	DataStream_WriteUInt8(self, (uint8)data);
 }
 
 void DataStream_WriteInt16(DataStream* self, int16 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	DataStream_WriteUInt16(self, (uint16)data);
 }
 
 void DataStream_WriteInt32(DataStream* self, int32 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	DataStream_WriteUInt32(self, (uint32)data);
 }
 
 void DataStream_WriteInt64(DataStream* self, int64 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	DataStream_WriteUInt64(self, (uint64)data);
 }
 
 void DataStream_WriteFloat32(DataStream* self, float32 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	uint32 bits;
+
+	memcpy(&bits, &data, sizeof(bits));
+	DataStream_WriteUInt32(self, bits);
 }
 
 void DataStream_WriteFloat64(DataStream* self, float64 data) {
-	DataStream_WriteBytes(self, (uint8*)&data, sizeof(data), false);
+	uint64 bits;
+
+	memcpy(&bits, &data, sizeof(bits));
+	DataStream_WriteUInt64(self, bits);
 }
 
 void DataStream_WriteBytes(DataStream* self, uint8* data, uint64 count, boolean disposeBytes) {
+	uint64 written;
+	uint64 room;
+
 	assert(self != NULL);
-	assert(data != NULL);
+	assert(data != NULL || count == 0);
+
+	for (written = 0; written < count; written += room) {
+		room = DataStream_Room(self, count - written);
 
-	Array_Write(&self->Data, data, self->Cursor, count);
-	self->Cursor += count;
+		Memory_BlockCopy(data + written, self->Data.Data + self->Cursor, room);
+		self->Cursor += room;
+	}
 
 	if (disposeBytes)
 		Free(data);
@@ -102,81 +559,47 @@ void DataStream_WriteArray(DataStream* self, Array* array, boolean disposeArray)
 	assert(self != NULL);
 	assert(array != NULL);
 
-	Array_Append(&self->Data, array);
+	DataStream_WriteBytes(self, array->Data, array->Size, false);
 
 	if (disposeArray)
 		Array_Free(array);
 }
 
+/* Writes the length as a varint prefix, so short strings cost one extra byte and long ones are not limited in size, followed by the bytes. */
 void DataStream_WriteString(DataStream* self, String* string, boolean disposeString) {
-	DataStream_WriteBytes(self, (uint8*)&string->Length, sizeof(string->Length), false);
-	DataStream_WriteArray(self, &string->Data, false);
+	assert(self != NULL);
+	assert(string != NULL);
+
+	DataStream_WriteVarUInt(self, string->Length);
+
+	if (string->Length != 0)
+		DataStream_WriteBytes(self, String_GetData(string), string->Length, false);
 
 	if (disposeString)
 		String_Free(string);
 }
 
-int8 DataStream_ReadInt8(DataStream* self) {
-	int8 result = 0;
-
-	if (self->Cursor + sizeof(int8) < self->Data.Size) {
-		result = *(int8*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(int8);
-	}
-	else
-		self->IsEOF = true;
-
-	return result;
+void DataStream_WriteView(DataStream* self, ArrayView view) {
+	DataStream_WriteBytes(self, view.Data, view.Size, false);
 }
 
-int16 DataStream_ReadInt16(DataStream* self) {
-	int16 result = 0;
-
-	if (self->Cursor + sizeof(int16) <= self->Data.Size) {
-		result = *(int16*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(int16);
-	}
-	else
+/* Copies the next size bytes into result, or sets IsEOF and leaves result alone if there are not enough. */
+static boolean DataStream_ReadFixed(DataStream* self, void* result, uint8 size) {
+	if (!DataStream_Fill(self, size)) {
 		self->IsEOF = true;
-
-	return result;
-}
-
-int32 DataStream_ReadInt32(DataStream* self) {
-	int32 result = 0;
-
-	if (self->Cursor + sizeof(int32) <= self->Data.Size) {
-		result = *(int32*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(int32);
+		return false;
 	}
-	else
-		self->IsEOF = true;
-
-	return result;
-}
 
-int64 DataStream_ReadInt64(DataStream* self) {
-	int64 result = 0;
-
-	if (self->Cursor + sizeof(int64) <= self->Data.Size) {
-		result = *(long*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(int64);
-	}
-	else
-		self->IsEOF = true;
+	memcpy(result, self->Data.Data + self->Cursor, size);
+	self->Cursor += size;
 
-	return result;
+	return true;
 }
 
 uint8 DataStream_ReadUInt8(DataStream* self) {
 	uint8 result = 0;
 
-	if (self->Cursor + sizeof(uint8) <= self->Data.Size) {
-		result = *(uint8*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(uint8);
-	}
-	else
-		self->IsEOF = true;
+	DataStream_ReadFixed(self, &result, sizeof(result));
 
 	return result;
 }
@@ -184,12 +607,8 @@ uint8 DataStream_ReadUInt8(DataStream* self) {
 uint16 DataStream_ReadUInt16(DataStream* self) {
 	uint16 result = 0;
 
-	if (self->Cursor + sizeof(uint16) <= self->Data.Size) {
-		result = *(uint16*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(uint16);
-	}
-	else
-		self->IsEOF = true;
+	if (DataStream_ReadFixed(self, &result, sizeof(result)) && self->IsSwapped)
+		result = ByteSwap16(result);
 
 	return result;
 }
@@ -197,12 +616,8 @@ uint16 DataStream_ReadUInt16(DataStream* self) {
 uint32 DataStream_ReadUInt32(DataStream* self) {
 	uint32 result = 0;
 
-	if (self->Cursor + sizeof(uint32) <= self->Data.Size) {
-		result = *(uint32*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(uint32);
-	}
-	else
-		self->IsEOF = true;
+	if (DataStream_ReadFixed(self, &result, sizeof(result)) && self->IsSwapped)
+		result = ByteSwap32(result);
 
 	return result;
 }
@@ -210,50 +625,56 @@ uint32 DataStream_ReadUInt32(DataStream* self) {
 uint64 DataStream_ReadUInt64(DataStream* self) {
 	uint64 result = 0;
 
-	if (self->Cursor + sizeof(uint64) <= self->Data.Size) {
-		result = *(unsigned long*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(uint64);
-	}
-	else
-		self->IsEOF = true;
+	if (DataStream_ReadFixed(self, &result, sizeof(result)) && self->IsSwapped)
+		result = ByteSwap64(result);
 
 	return result;
 }
 
+int8 DataStream_ReadInt8(DataStream* self) {
+	return (int8)DataStream_ReadUInt8(self);
+}
+
+int16 DataStream_ReadInt16(DataStream* self) {
+	return (int16)DataStream_ReadUInt16(self);
+}
+
+int32 DataStream_ReadInt32(DataStream* self) {
+	return (int32)DataStream_ReadUInt32(self);
+}
+
+int64 DataStream_ReadInt64(DataStream* self) {
+	return (int64)DataStream_ReadUInt64(self);
+}
+
 float32 DataStream_ReadFloat32(DataStream* self) {
-	float32 result = 0;
+	float32 result;
+	uint32 bits;
 
-	if (self->Cursor + sizeof(float32) <= self->Data.Size) {
-		result = *(float32*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(float32);
-	}
-	else
-		self->IsEOF = true;
+	bits = DataStream_ReadUInt32(self);
+	memcpy(&result, &bits, sizeof(result));
 
 	return result;
 }
 
 float64 DataStream_ReadFloat64(DataStream* self) {
-	float64 result = 0;
+	float64 result;
+	uint64 bits;
 
-	if (self->Cursor + sizeof(float64) <= self->Data.Size) {
-		result = *(float64*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(float64);
-	}
-	else
-		self->IsEOF = true;
+	bits = DataStream_ReadUInt64(self);
+	memcpy(&result, &bits, sizeof(result));
 
 	return result;
 }
 
-/*should this return a pointer within the backing data store itself or create a new allocation and return that?*/
+/* Returns a pointer to the next count bytes within the stream itself, not a copy. It is only valid until the stream is next written to. */
 uint8* DataStream_ReadBytes(DataStream* self, uint64 count) {
 	uint8* result;
 
 	result = NULL;
 
-	if (self->Cursor + count < self->Data.Size) {
-		result = self->Data.Data + self->Cursor + count - 1;
+	if (DataStream_Fill(self, count)) {
+		result = self->Data.Data + self->Cursor;
 		self->Cursor += count;
 	}
 	else
@@ -267,7 +688,7 @@ Array* DataStream_ReadArray(DataStream* self, uint64 count) {
 
 	array = NULL;
 
-	if (self->Cursor + count <= self->Data.Size) {
+	if (DataStream_Fill(self, count)) {
 		array = Array_New(count);
 		Array_Write(array, self->Data.Data + self->Cursor, 0, count);
 		self->Cursor += count;
@@ -279,29 +700,986 @@ Array* DataStream_ReadArray(DataStream* self, uint64 count) {
 	return array;
 }
 
+/*
+ * Called with the cursor just past a length prefix that began at start: makes
+ * the prefix and the count bytes after it available, leaving the cursor after
+ * the prefix, or puts the cursor back on the prefix and returns false.
+ */
+static boolean DataStream_FillAfter(DataStream* self, uint64 start, uint64 count) {
+	uint64 prefix;
+	boolean result;
+
+	prefix = self->Cursor - start;
+	self->Cursor = start;
+
+	result = count <= ~(uint64)0 - prefix && DataStream_Fill(self, prefix + count);
+
+	if (result)
+		self->Cursor += prefix;
+
+	return result;
+}
+
 String* DataStream_ReadString(DataStream* self) {
-	uint16 length;
+	uint64 start;
+	uint64 length;
 	String* string;
 
-	string = NULL;
-	length = 0;
+	assert(self != NULL);
+
+	/* bring the prefix into the window first, since filling may move the cursor */
+	DataStream_Fill(self, DATASTREAM_VARINT_MAX);
 
-	if (self->Cursor + sizeof(uint16) <= self->Data.Size) {
-		length = *(uint16*)(self->Data.Data + self->Cursor);
-		self->Cursor += sizeof(uint16);
+	start = self->Cursor;
 
-		if (self->Cursor + length <= self->Data.Size) {
-			string = String_New(length);
-			String_AppendBytes(string, (int8*)(self->Data.Data + self->Cursor), length);
-			self->Cursor += length;
-		}
-		else {
-			self->IsEOF = true;
-			self->Cursor -= sizeof(uint16);
-		}
+	if (!DataStream_DecodeVarUInt(self, &length) || !DataStream_FillAfter(self, start, length)) {
+		self->IsEOF = true;
+
+		return NULL;
+	}
+
+	string = String_New(length);
+	String_AppendBytes(string, (int8*)(self->Data.Data + self->Cursor), length);
+	self->Cursor += length;
+
+	return string;
+}
+
+/* Reads a string written by DataStream_WriteString as a view of its bytes in the stream, without copying them. The view is empty and IsEOF is set if the string is truncated. */
+ArrayView DataStream_ReadStringView(DataStream* self) {
+	uint64 start;
+	uint64 length;
+	ArrayView view;
+
+	assert(self != NULL);
+
+	/* bring the prefix into the window first, since filling may move the cursor */
+	DataStream_Fill(self, DATASTREAM_VARINT_MAX);
+
+	start = self->Cursor;
+
+	if (!DataStream_DecodeVarUInt(self, &length) || !DataStream_FillAfter(self, start, length)) {
+		self->IsEOF = true;
+
+		return ArrayView_FromBytes(NULL, 0);
+	}
+
+	view = ArrayView_FromBytes(self->Data.Data + self->Cursor, length);
+	self->Cursor += length;
+
+	return view;
+}
+
+/* Returns a view of the next count bytes without copying them. The view is only valid until the stream is next written to. */
+ArrayView DataStream_ReadView(DataStream* self, uint64 count) {
+	ArrayView view;
+
+	view = ArrayView_FromBytes(NULL, 0);
+
+	if (DataStream_Fill(self, count)) {
+		view = ArrayView_FromBytes(self->Data.Data + self->Cursor, count);
+		self->Cursor += count;
 	}
 	else
 		self->IsEOF = true;
 
-	return string;
+	return view;
+}
+
+/**
+ * Writes @a value as an unsigned LEB128 varint: seven bits per byte, least
+ * significant group first, with the high bit set on every byte but the last.
+ * Values below 128 take one byte, and no value takes more than
+ * DATASTREAM_VARINT_MAX.
+ */
+void DataStream_WriteVarUInt(DataStream* self, uint64 value) {
+	uint8 buffer[DATASTREAM_VARINT_MAX];
+	uint8 count;
+
+	for (count = 0; value >= 0x80; value >>= 7)
+		buffer[count++] = (uint8)(value | 0x80);
+
+	buffer[count++] = (uint8)value;
+
+	DataStream_WriteBytes(self, buffer, count, false);
+}
+
+/* Writes a signed value zigzag encoded (0, -1, 1, -2... map to 0, 1, 2, 3...) so that small negative numbers stay short. */
+void DataStream_WriteVarInt(DataStream* self, int64 value) {
+	DataStream_WriteVarUInt(self, ((uint64)value << 1) ^ (uint64)(value >> 63));
+}
+
+uint64 DataStream_ReadVarUInt(DataStream* self) {
+	uint64 value;
+
+	assert(self != NULL);
+
+	if (!DataStream_DecodeVarUInt(self, &value)) {
+		self->IsEOF = true;
+		value = 0;
+	}
+
+	return value;
+}
+
+int64 DataStream_ReadVarInt(DataStream* self) {
+	uint64 value;
+
+	value = DataStream_ReadVarUInt(self);
+
+	return (int64)(value >> 1) ^ -(int64)(value & 1);
+}
+
+/* Leaves the cursor after the varint on success, and where it was on a truncated varint or one too long for a uint64. */
+static boolean DataStream_DecodeVarUInt(DataStream* self, uint64* value) {
+	uint64 result;
+	uint64 start;
+	uint8 shift;
+	uint8 byte;
+
+	DataStream_Fill(self, DATASTREAM_VARINT_MAX);
+
+	result = 0;
+	start = self->Cursor;
+
+	for (shift = 0; shift < DATASTREAM_VARINT_MAX * 7 && self->Cursor < self->Data.Size; shift += 7) {
+		byte = self->Data.Data[self->Cursor++];
+		result |= (uint64)(byte & 0x7F) << shift;
+
+		if ((byte & 0x80) == 0) {
+			*value = result;
+			return true;
+		}
+	}
+
+	self->Cursor = start;
+
+	return false;
+}
+
+/*
+ * Packed arrays use the Stream VByte layout (Lemire, Kurz and Rupp): each
+ * value takes one to four little-endian bytes, and a two-bit length code for
+ * every value is kept apart from the data so a decoder can look up where each
+ * value's bytes are without a branch per byte. The array is written as its
+ * count, as a varint, followed by blocks of DATASTREAM_PACKED_BLOCK values:
+ * the length codes of the block, four per byte, first value in the low bits,
+ * then the block's data bytes.
+ */
+
+static uint8 DataStream_PackedLength(uint32 value) {
+	return (uint8)(1 + (value > 0xFF) + (value > 0xFFFF) + (value > 0xFFFFFF));
+}
+
+static void DataStream_WritePacked(DataStream* self, uint32* values, uint64 count, boolean zigzag) {
+	uint8 block[DATASTREAM_PACKED_BLOCK / 4 + DATASTREAM_PACKED_BLOCK * 4];
+	uint64 i;
+	uint64 end;
+	uint32 controlBytes;
+	uint32 size;
+	uint32 value;
+	uint8 length;
+	uint8 j;
+
+	assert(self != NULL);
+	assert(values != NULL || count == 0);
+
+	DataStream_WriteVarUInt(self, count);
+
+	for (i = 0; i < count; i = end) {
+		end = count - i > DATASTREAM_PACKED_BLOCK ? i + DATASTREAM_PACKED_BLOCK : count;
+		controlBytes = (uint32)(end - i + 3) / 4;
+		size = controlBytes;
+		memset(block, 0, controlBytes);
+
+		for (j = 0; i + j < end; j++) {
+			value = values[i + j];
+
+			if (zigzag)
+				value = (value << 1) ^ (uint32)((int32)value >> 31);
+
+			length = DataStream_PackedLength(value);
+			block[j / 4] |= (uint8)((length - 1) << ((j % 4) * 2));
+
+			block[size] = (uint8)value;
+			block[size + 1] = (uint8)(value >> 8);
+			block[size + 2] = (uint8)(value >> 16);
+			block[size + 3] = (uint8)(value >> 24);
+			size += length;
+		}
+
+		DataStream_WriteBytes(self, block, size, false);
+	}
+}
+
+#ifdef INTRINSICS_X86
+
+static uint8 packedShuffles[256][16]; /* for each length byte, where each output byte comes from; 0x80 zeroes it */
+
+/*
+ * Decodes four values per step with one shuffle, for as long as 16 bytes
+ * remain to be loaded. Returns the number of groups of four decoded and
+ * stores the number of data bytes they took in used.
+ */
+static uint64 TARGET("ssse3") DataStream_UnpackSSSE3(uint8* controls, uint8* data, uint64 available, uint32* output, uint64 groups, uint64* used) {
+	uint64 g;
+	uint64 offset;
+
+	for (g = 0, offset = 0; g < groups && available - offset >= 16; g++) {
+		_mm_storeu_si128((__m128i*)(output + g * 4), _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)(data + offset)), _mm_loadu_si128((__m128i*)packedShuffles[controls[g]])));
+		offset += 4 + (controls[g] & 3) + ((controls[g] >> 2) & 3) + ((controls[g] >> 4) & 3) + (controls[g] >> 6);
+	}
+
+	*used = offset;
+
+	return g;
+}
+
+#endif
+
+/* Decodes whole groups of four a byte at a time, stopping at the first group that runs past available. */
+static uint64 DataStream_UnpackScalar(uint8* controls, uint8* data, uint64 available, uint32* output, uint64 groups, uint64* used) {
+	uint64 g;
+	uint64 offset;
+	uint32 value;
+	uint8 length;
+	uint8 k;
+
+	for (g = 0, offset = 0; g < groups; g++) {
+		if (4U + (controls[g] & 3) + ((controls[g] >> 2) & 3) + ((controls[g] >> 4) & 3) + (controls[g] >> 6) > available - offset)
+			break;
+
+		for (k = 0; k < 4; k++) {
+			length = (uint8)(((controls[g] >> (k * 2)) & 3) + 1);
+
+			value = data[offset];
+			if (length > 1) value |= (uint32)data[offset + 1] << 8;
+			if (length > 2) value |= (uint32)data[offset + 2] << 16;
+			if (length > 3) value |= (uint32)data[offset + 3] << 24;
+
+			output[g * 4 + k] = value;
+			offset += length;
+		}
+	}
+
+	*used = offset;
+
+	return g;
+}
+
+static uint64 DataStream_UnpackResolve(uint8* controls, uint8* data, uint64 available, uint32* output, uint64 groups, uint64* used);
+
+static uint64 (*unpackKernel)(uint8* controls, uint8* data, uint64 available, uint32* output, uint64 groups, uint64* used) = DataStream_UnpackResolve;
+
+static uint64 DataStream_UnpackResolve(uint8* controls, uint8* data, uint64 available, uint32* output, uint64 groups, uint64* used) {
+#ifdef INTRINSICS_X86
+	uint32 control;
+	uint32 value;
+	uint32 offset;
+	uint32 length;
+	uint32 k;
+
+	if (Memory_GetCPUFeatures() & MEMORY_CPU_SSE41) {
+		for (control = 0; control < 256; control++) {
+			for (value = 0, offset = 0; value < 4; value++) {
+				length = ((control >> (value * 2)) & 3) + 1;
+
+				for (k = 0; k < 4; k++)
+					packedShuffles[control][value * 4 + k] = (uint8)(k < length ? offset + k : 0x80);
+
+				offset += length;
+			}
+		}
+
+		Atomic_Fence();
+		unpackKernel = DataStream_UnpackSSSE3;
+	}
+	else {
+		unpackKernel = DataStream_UnpackScalar;
+	}
+#else
+	unpackKernel = DataStream_UnpackScalar;
+#endif
+
+	return unpackKernel(controls, data, available, output, groups, used);
+}
+
+/* Returns the number of values read, or 0 with IsEOF set and the cursor unmoved if the array is truncated or holds more than capacity values. */
+static uint64 DataStream_ReadPacked(DataStream* self, uint32* values, uint64 capacity, boolean zigzag) {
+	uint64 start;
+	uint64 startOffset;
+	uint64 count;
+	uint64 i;
+	uint64 end;
+	uint64 controlBytes;
+	uint64 position;
+	uint64 done;
+	uint64 used;
+	uint8* controls;
+	uint8* data;
+	uint8 length;
+	uint32 value;
+	uint8 j;
+
+	assert(self != NULL);
+	assert(values != NULL || capacity == 0);
+
+	DataStream_Fill(self, DATASTREAM_VARINT_MAX);
+
+	start = self->Cursor;
+	startOffset = self->FileOffset;
+
+	if (!DataStream_DecodeVarUInt(self, &count) || count > capacity)
+		goto fail;
+
+	for (i = 0; i < count; i = end) {
+		end = count - i > DATASTREAM_PACKED_BLOCK ? i + DATASTREAM_PACKED_BLOCK : count;
+		controlBytes = (end - i + 3) / 4;
+
+		/* a file stream brings the whole block into the window; a truncated one is caught below */
+		DataStream_Fill(self, controlBytes + (end - i) * 4);
+
+		if (controlBytes > self->Data.Size - self->Cursor)
+			goto fail;
+
+		controls = self->Data.Data + self->Cursor;
+		data = controls + controlBytes;
+		position = self->Cursor + controlBytes;
+
+		/* whole groups of four with a kernel while they fit, the rest one value at a time */
+		done = unpackKernel(controls, data, self->Data.Size - position, values + i, (end - i) / 4, &used) * 4;
+		position += used;
+
+		for (j = (uint8)done; i + j < end; j++) {
+			length = (uint8)(((controls[j / 4] >> ((j % 4) * 2)) & 3) + 1);
+
+			if (length > self->Data.Size - position)
+				goto fail;
+
+			value = self->Data.Data[position];
+			if (length > 1) value |= (uint32)self->Data.Data[position + 1] << 8;
+			if (length > 2) value |= (uint32)self->Data.Data[position + 2] << 16;
+			if (length > 3) value |= (uint32)self->Data.Data[position + 3] << 24;
+
+			values[i + j] = value;
+			position += length;
+		}
+
+		self->Cursor = position;
+	}
+
+	if (zigzag)
+		for (i = 0; i < count; i++)
+			values[i] = (values[i] >> 1) ^ (0 - (values[i] & 1));
+
+	return count;
+
+fail:
+	/* a file stream that has moved its window since cannot go back */
+	if (self->FileOffset == startOffset)
+		self->Cursor = start;
+
+	self->IsEOF = true;
+
+	return 0;
+}
+
+/**
+ * Writes an array of unsigned values in a packed varint format (see
+ * DataStream_ReadVarUInt32Array) that decodes four values per instruction
+ * sequence on x86. Small values take one byte each plus two bits.
+ */
+void DataStream_WriteVarUInt32Array(DataStream* self, uint32* values, uint64 count) {
+	DataStream_WritePacked(self, values, count, false);
+}
+
+/* Like DataStream_WriteVarUInt32Array, but zigzag encodes each value first so small negative values stay short. */
+void DataStream_WriteVarInt32Array(DataStream* self, int32* values, uint64 count) {
+	DataStream_WritePacked(self, (uint32*)values, count, true);
+}
+
+/**
+ * Reads an array written by DataStream_WriteVarUInt32Array.
+ *
+ * @param values Receives the values
+ * @param capacity Number of values @a values can hold
+ * @returns the number of values read. On a truncated array, or one with more
+ * than @a capacity values, returns 0 and sets IsEOF without moving the cursor.
+ */
+uint64 DataStream_ReadVarUInt32Array(DataStream* self, uint32* values, uint64 capacity) {
+	return DataStream_ReadPacked(self, values, capacity, false);
+}
+
+uint64 DataStream_ReadVarInt32Array(DataStream* self, int32* values, uint64 capacity) {
+	return DataStream_ReadPacked(self, (uint32*)values, capacity, true);
+}
+
+#ifdef INTRINSICS_X86
+
+static uint64 TARGET("ssse3") DataStream_SwapSSSE3(uint8* source, uint8* destination, uint64 count, uint8 size) {
+	__m128i shuffle;
+	uint64 length;
+	uint64 i;
+
+	switch (size) {
+		case 2: shuffle = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14); break;
+		case 4: shuffle = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12); break;
+		default: shuffle = _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8); break;
+	}
+
+	length = count * size;
+
+	for (i = 0; i + 16 <= length; i += 16)
+		_mm_storeu_si128((__m128i*)(destination + i), _mm_shuffle_epi8(_mm_loadu_si128((__m128i*)(source + i)), shuffle));
+
+	return i / size;
+}
+
+static uint64 TARGET("avx2") DataStream_SwapAVX2(uint8* source, uint8* destination, uint64 count, uint8 size) {
+	__m256i shuffle;
+	uint64 length;
+	uint64 i;
+
+	/* the same pattern in both lanes, since no element crosses a 16 byte boundary */
+	switch (size) {
+		case 2: shuffle = _mm256_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14, 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14); break;
+		case 4: shuffle = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12); break;
+		default: shuffle = _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8); break;
+	}
+
+	length = count * size;
+
+	for (i = 0; i + 32 <= length; i += 32)
+		_mm256_storeu_si256((__m256i*)(destination + i), _mm256_shuffle_epi8(_mm256_loadu_si256((__m256i*)(source + i)), shuffle));
+
+	return i / size;
+}
+
+#endif
+
+static uint64 DataStream_SwapScalar(uint8* source, uint8* destination, uint64 count, uint8 size) {
+	uint64 i;
+	uint16 value16;
+	uint32 value32;
+	uint64 value64;
+
+	for (i = 0; i < count; i++) {
+		switch (size) {
+			case 2:
+				memcpy(&value16, source + i * 2, 2);
+				value16 = ByteSwap16(value16);
+				memcpy(destination + i * 2, &value16, 2);
+				break;
+
+			case 4:
+				memcpy(&value32, source + i * 4, 4);
+				value32 = ByteSwap32(value32);
+				memcpy(destination + i * 4, &value32, 4);
+				break;
+
+			default:
+				memcpy(&value64, source + i * 8, 8);
+				value64 = ByteSwap64(value64);
+				memcpy(destination + i * 8, &value64, 8);
+				break;
+		}
+	}
+
+	return count;
+}
+
+static uint64 DataStream_SwapResolve(uint8* source, uint8* destination, uint64 count, uint8 size);
+
+static uint64 (*swapKernel)(uint8* source, uint8* destination, uint64 count, uint8 size) = DataStream_SwapResolve;
+
+static uint64 DataStream_SwapResolve(uint8* source, uint8* destination, uint64 count, uint8 size) {
+#ifdef INTRINSICS_X86
+	uint32 features;
+
+	features = Memory_GetCPUFeatures();
+
+	if (features & MEMORY_CPU_AVX2)
+		swapKernel = DataStream_SwapAVX2;
+	else if (features & MEMORY_CPU_SSE41)
+		swapKernel = DataStream_SwapSSSE3;
+	else
+		swapKernel = DataStream_SwapScalar;
+#else
+	swapKernel = DataStream_SwapScalar;
+#endif
+
+	return swapKernel(source, destination, count, size);
+}
+
+/* Copies count elements of size bytes, reversing the bytes of each: whole vectors with the kernel, the remainder one element at a time. */
+static void DataStream_SwapCopy(uint8* source, uint8* destination, uint64 count, uint8 size) {
+	uint64 done;
+
+	done = swapKernel(source, destination, count, size);
+
+	if (done < count)
+		DataStream_SwapScalar(source + done * size, destination + done * size, count - done, size);
+}
+
+static void DataStream_WriteElements(DataStream* self, void* values, uint64 count, uint8 size) {
+	uint64 done;
+	uint64 room;
+
+	assert(self != NULL);
+	assert(values != NULL || count == 0);
+
+	if (!self->IsSwapped || size == 1) {
+		DataStream_WriteBytes(self, (uint8*)values, count * size, false);
+		return;
+	}
+
+	/* a file stream takes as many whole values at a time as its window has room for */
+	for (done = 0; done < count; done += room) {
+		room = DataStream_Room(self, (count - done) * size) / size;
+
+		if (room == 0) {
+			DataStream_Reserve(self, size);
+			room = 1;
+		}
+
+		DataStream_SwapCopy((uint8*)values + done * size, self->Data.Data + self->Cursor, room, size);
+		self->Cursor += room * size;
+	}
+}
+
+static boolean DataStream_ReadElements(DataStream* self, void* values, uint64 count, uint8 size) {
+	uint64 done;
+	uint64 chunk;
+
+	assert(self != NULL);
+	assert(values != NULL || count == 0);
+
+	/* a memory stream copies everything at once; a file stream a window at a time, so a truncated file leaves the values before the end read */
+	for (done = 0; done < count; done += chunk) {
+		chunk = count - done;
+
+		if (self->File >= 0 && chunk > DATASTREAM_FILE_WINDOW / 2 / size)
+			chunk = DATASTREAM_FILE_WINDOW / 2 / size;
+
+		if (!DataStream_Fill(self, chunk * size)) {
+			self->IsEOF = true;
+			return false;
+		}
+
+		if (self->IsSwapped && size > 1)
+			DataStream_SwapCopy(self->Data.Data + self->Cursor, (uint8*)values + done * size, chunk, size);
+		else
+			Memory_BlockCopy(self->Data.Data + self->Cursor, (uint8*)values + done * size, chunk * size);
+
+		self->Cursor += chunk * size;
+	}
+
+	return true;
+}
+
+/**
+ * Writes @a count values in the stream's byte order. When that differs from
+ * the host's, the values are swapped 16 or 32 bytes at a time with vector
+ * shuffles as they are copied in.
+ */
+void DataStream_WriteUInt16Array(DataStream* self, uint16* values, uint64 count) {
+	DataStream_WriteElements(self, values, count, sizeof(uint16));
+}
+
+void DataStream_WriteUInt32Array(DataStream* self, uint32* values, uint64 count) {
+	DataStream_WriteElements(self, values, count, sizeof(uint32));
+}
+
+void DataStream_WriteUInt64Array(DataStream* self, uint64* values, uint64 count) {
+	DataStream_WriteElements(self, values, count, sizeof(uint64));
+}
+
+void DataStream_WriteFloat32Array(DataStream* self, float32* values, uint64 count) {
+	DataStream_WriteElements(self, values, count, sizeof(float32));
+}
+
+void DataStream_WriteFloat64Array(DataStream* self, float64* values, uint64 count) {
+	DataStream_WriteElements(self, values, count, sizeof(float64));
+}
+
+/**
+ * Reads @a count values, converting them from the stream's byte order.
+ *
+ * @returns false, reading nothing and setting IsEOF, if fewer than @a count
+ * values remain
+ */
+boolean DataStream_ReadUInt16Array(DataStream* self, uint16* values, uint64 count) {
+	return DataStream_ReadElements(self, values, count, sizeof(uint16));
+}
+
+boolean DataStream_ReadUInt32Array(DataStream* self, uint32* values, uint64 count) {
+	return DataStream_ReadElements(self, values, count, sizeof(uint32));
+}
+
+boolean DataStream_ReadUInt64Array(DataStream* self, uint64* values, uint64 count) {
+	return DataStream_ReadElements(self, values, count, sizeof(uint64));
+}
+
+boolean DataStream_ReadFloat32Array(DataStream* self, float32* values, uint64 count) {
+	return DataStream_ReadElements(self, values, count, sizeof(float32));
+}
+
+boolean DataStream_ReadFloat64Array(DataStream* self, float64* values, uint64 count) {
+	return DataStream_ReadElements(self, values, count, sizeof(float64));
+}
+
+static uint8 DataStream_FieldSize(uint8 type) {
+	switch (type) {
+		case DATASTREAM_FIELD_INT8: case DATASTREAM_FIELD_UINT8: return 1;
+		case DATASTREAM_FIELD_INT16: case DATASTREAM_FIELD_UINT16: return 2;
+		case DATASTREAM_FIELD_INT32: case DATASTREAM_FIELD_UINT32: case DATASTREAM_FIELD_FLOAT32: return 4;
+		case DATASTREAM_FIELD_INT64: case DATASTREAM_FIELD_UINT64: case DATASTREAM_FIELD_FLOAT64: return 8;
+		default: return 0;
+	}
+}
+
+static uint8 DataStream_VarUIntSize(uint64 value) {
+	uint8 size;
+
+	for (size = 1; value >= 0x80; value >>= 7)
+		size++;
+
+	return size;
+}
+
+DataStream_Schema* DataStream_Schema_New(DataStream_Field* fields, uint32 count, uint32 version) {
+	DataStream_Schema* schema;
+
+	schema = Allocate(DataStream_Schema);
+	DataStream_Schema_Initialize(schema, fields, count, version);
+
+	return schema;
+}
+
+/**
+ * Prepares a schema from a table of DATASTREAM_FIELD entries, which is copied.
+ * Consecutive fields that sit next to each other in the struct, with no
+ * padding between them, are merged into runs that are encoded and decoded
+ * with a single copy when the stream is in host byte order.
+ *
+ * @param version the version records are written as, at least the Since of
+ * every field
+ */
+void DataStream_Schema_Initialize(DataStream_Schema* schema, DataStream_Field* fields, uint32 count, uint32 version) {
+	DataStream_SchemaRun* run;
+	DataStream_Field* field;
+	uint32 allocation;
+	uint32 i;
+
+	assert(schema != NULL);
+	assert(fields != NULL || count == 0);
+
+	allocation = count > 0 ? count : 1;
+	schema->Fields = AllocateArray(DataStream_Field, allocation);
+	schema->Runs = AllocateArray(DataStream_SchemaRun, allocation);
+	schema->FieldCount = count;
+	schema->RunCount = 0;
+	schema->Version = version;
+
+	run = NULL;
+
+	for (i = 0; i < count; i++) {
+		field = schema->Fields + i;
+		*field = fields[i];
+
+		assert(field->Since <= version);
+		assert(i == 0 || field->Since >= fields[i - 1].Since);
+		assert(field->Type == DATASTREAM_FIELD_STRING ? field->Length == sizeof(String) : field->Length % DataStream_FieldSize(field->Type) == 0);
+
+		/* a string always starts its own run and nothing joins it, nor does a field from a later version join an earlier one */
+		if (run != NULL && field->Type != DATASTREAM_FIELD_STRING && schema->Fields[run->First].Type != DATASTREAM_FIELD_STRING && field->Since == run->Since && field->Offset == run->Offset + run->Length) {
+			run->Length += field->Length;
+			run->Count++;
+			continue;
+		}
+
+		run = schema->Runs + schema->RunCount++;
+		run->Offset = field->Offset;
+		run->Length = field->Length;
+		run->Since = field->Since;
+		run->First = i;
+		run->Count = 1;
+	}
+}
+
+void DataStream_Schema_Free(DataStream_Schema* self) {
+	assert(self != NULL);
+
+	DataStream_Schema_Uninitialize(self);
+	Free(self);
+}
+
+void DataStream_Schema_Uninitialize(DataStream_Schema* self) {
+	assert(self != NULL);
+
+	Free(self->Fields);
+	Free(self->Runs);
+	self->Fields = NULL;
+	self->Runs = NULL;
+	self->FieldCount = 0;
+	self->RunCount = 0;
+}
+
+/**
+ * Writes the members of the struct at @a value that @a schema describes, as
+ * a record: the schema version and the length of the rest of the record, as
+ * varints, then each field in table order in the stream's byte order. Arrays
+ * are written element by element and strings as by DataStream_WriteString.
+ */
+void DataStream_WriteStruct(DataStream* self, DataStream_Schema* schema, void* value) {
+	DataStream_SchemaRun* run;
+	DataStream_Field* field;
+	String* string;
+	uint64 length;
+	uint32 i;
+	uint32 j;
+	uint8 size;
+
+	assert(self != NULL);
+	assert(schema != NULL);
+	assert(value != NULL);
+
+	/* the length lets a reader skip fields added after its version, and is known up front so nothing needs patching in a file stream */
+	for (i = 0, length = 0; i < schema->RunCount; i++) {
+		run = schema->Runs + i;
+
+		if (schema->Fields[run->First].Type == DATASTREAM_FIELD_STRING) {
+			string = (String*)((uint8*)value + run->Offset);
+			length += DataStream_VarUIntSize(string->Length) + string->Length;
+		}
+		else {
+			length += run->Length;
+		}
+	}
+
+	DataStream_WriteVarUInt(self, schema->Version);
+	DataStream_WriteVarUInt(self, length);
+
+	for (i = 0; i < schema->RunCount; i++) {
+		run = schema->Runs + i;
+		field = schema->Fields + run->First;
+
+		if (field->Type == DATASTREAM_FIELD_STRING) {
+			DataStream_WriteString(self, (String*)((uint8*)value + run->Offset), false);
+		}
+		else if (!self->IsSwapped) {
+			DataStream_WriteBytes(self, (uint8*)value + run->Offset, run->Length, false);
+		}
+		else {
+			for (j = 0; j < run->Count; j++, field++) {
+				size = DataStream_FieldSize(field->Type);
+				DataStream_WriteElements(self, (uint8*)value + field->Offset, field->Length / size, size);
+			}
+		}
+	}
+}
+
+/**
+ * Reads a record written by DataStream_WriteStruct into the struct at
+ * @a value. A record from an older version leaves the fields it does not
+ * have untouched, so set their defaults first; a record from a newer version
+ * has the fields this schema does not know skipped. String members must
+ * already be initialized, and their contents are replaced.
+ *
+ * @returns false, setting IsEOF, if the record is truncated or malformed.
+ * Fields before the point of failure may have been overwritten.
+ */
+boolean DataStream_ReadStruct(DataStream* self, DataStream_Schema* schema, void* value) {
+	DataStream_SchemaRun* run;
+	DataStream_Field* field;
+	ArrayView view;
+	String* string;
+	uint64 version;
+	uint64 remaining;
+	uint64 length;
+	uint32 i;
+	uint32 j;
+	uint8 size;
+
+	assert(self != NULL);
+	assert(schema != NULL);
+	assert(value != NULL);
+
+	version = DataStream_ReadVarUInt(self);
+	remaining = DataStream_ReadVarUInt(self);
+
+	if (self->IsEOF)
+		return false;
+
+	for (i = 0; i < schema->RunCount && schema->Runs[i].Since <= version; i++) {
+		run = schema->Runs + i;
+		field = schema->Fields + run->First;
+
+		if (field->Type == DATASTREAM_FIELD_STRING) {
+			length = DataStream_ReadVarUInt(self);
+
+			if (self->IsEOF || length > remaining || DataStream_VarUIntSize(length) + length > remaining)
+				goto fail;
+
+			view = DataStream_ReadView(self, length);
+			if (self->IsEOF)
+				goto fail;
+
+			string = (String*)((uint8*)value + run->Offset);
+			String_Clear(string);
+			String_AppendView(string, view);
+
+			remaining -= DataStream_VarUIntSize(length) + length;
+			continue;
+		}
+
+		if (run->Length > remaining)
+			goto fail;
+
+		if (!self->IsSwapped) {
+			if (!DataStream_ReadElements(self, (uint8*)value + run->Offset, run->Length, 1))
+				goto fail;
+		}
+		else {
+			for (j = 0; j < run->Count; j++, field++) {
+				size = DataStream_FieldSize(field->Type);
+
+				if (!DataStream_ReadElements(self, (uint8*)value + field->Offset, field->Length / size, size))
+					goto fail;
+			}
+		}
+
+		remaining -= run->Length;
+	}
+
+	/* fields from versions newer than the schema */
+	if (remaining > 0 && DataStream_ReadView(self, remaining).Size != remaining)
+		goto fail;
+
+	return true;
+
+fail:
+	self->IsEOF = true;
+
+	return false;
+}
+
+static void DataStream_PutLittle32(uint8* output, uint32 value) {
+	output[0] = (uint8)value;
+	output[1] = (uint8)(value >> 8);
+	output[2] = (uint8)(value >> 16);
+	output[3] = (uint8)(value >> 24);
+}
+
+static uint32 DataStream_GetLittle32(uint8* input) {
+	return input[0] | (uint32)input[1] << 8 | (uint32)input[2] << 16 | (uint32)input[3] << 24;
+}
+
+/**
+ * Compresses @a source into a frame at the cursor: a magic number, then
+ * blocks of up to COMPRESSION_BLOCK_SIZE bytes each compressed on their own
+ * with Compression_Compress, then an empty block. Each block is preceded by
+ * its size and its compressed size, as little-endian uint32s; a block that
+ * does not shrink is stored as is. The frame is written straight into the
+ * stream's buffer, one block at a time, so a file stream never holds more
+ * than a block of it.
+ *
+ * @param level one of the COMPRESSION_LEVEL_* values
+ */
+void DataStream_Compress(DataStream* self, ArrayView source, uint32 level) {
+	uint8* header;
+	uint64 position;
+	uint64 length;
+	uint64 compressed;
+
+	assert(self != NULL);
+	assert(source.Data != NULL || source.Size == 0);
+
+	DataStream_Reserve(self, 4);
+	DataStream_PutLittle32(self->Data.Data + self->Cursor, DATASTREAM_FRAME_MAGIC);
+	self->Cursor += 4;
+
+	for (position = 0; position < source.Size; position += length) {
+		length = source.Size - position > COMPRESSION_BLOCK_SIZE ? COMPRESSION_BLOCK_SIZE : source.Size - position;
+
+		DataStream_Reserve(self, 8 + Compression_Bound(length));
+		header = self->Data.Data + self->Cursor;
+
+		compressed = Compression_Compress(ArrayView_Slice(source, position, length), header + 8, length - 1, level);
+
+		if (compressed == 0) {
+			Memory_BlockCopy(source.Data + position, header + 8, length);
+			compressed = length | DATASTREAM_FRAME_STORED;
+		}
+
+		DataStream_PutLittle32(header, (uint32)length);
+		DataStream_PutLittle32(header + 4, (uint32)compressed);
+		self->Cursor += 8 + (compressed & ~(uint64)DATASTREAM_FRAME_STORED);
+	}
+
+	DataStream_Reserve(self, 4);
+	DataStream_PutLittle32(self->Data.Data + self->Cursor, 0);
+	self->Cursor += 4;
+}
+
+/**
+ * Reads a frame written by DataStream_Compress and writes what it holds to
+ * @a output at its cursor, a block at a time.
+ *
+ * @returns false, setting IsEOF, if the frame is truncated or corrupt. The
+ * blocks before the damage will have been written to @a output.
+ */
+boolean DataStream_Decompress(DataStream* self, DataStream* output) {
+	uint8* header;
+	uint8* block;
+	uint32 length;
+	uint32 compressed;
+	uint32 stored;
+
+	assert(self != NULL);
+	assert(output != NULL);
+
+	header = DataStream_ReadBytes(self, 4);
+	if (header == NULL || DataStream_GetLittle32(header) != DATASTREAM_FRAME_MAGIC)
+		goto fail;
+
+	for (;;) {
+		header = DataStream_ReadBytes(self, 4);
+		if (header == NULL)
+			goto fail;
+
+		length = DataStream_GetLittle32(header);
+		if (length == 0)
+			return true;
+
+		header = DataStream_ReadBytes(self, 4);
+		if (header == NULL)
+			goto fail;
+
+		compressed = DataStream_GetLittle32(header);
+		stored = compressed & DATASTREAM_FRAME_STORED;
+		compressed &= ~DATASTREAM_FRAME_STORED;
+
+		/* a corrupt size must not make us allocate far beyond a block */
+		if (length > COMPRESSION_BLOCK_SIZE || compressed > Compression_Bound(COMPRESSION_BLOCK_SIZE) || (stored && compressed != length))
+			goto fail;
+
+		block = DataStream_ReadBytes(self, compressed);
+		if (block == NULL)
+			goto fail;
+
+		DataStream_Reserve(output, length);
+
+		if (stored)
+			Memory_BlockCopy(block, output->Data.Data + output->Cursor, length);
+		else if (Compression_Decompress(ArrayView_FromBytes(block, compressed), output->Data.Data + output->Cursor, length) != length)
+			goto fail;
+
+		output->Cursor += length;
+	}
+
+fail:
+	self->IsEOF = true;
+
+	return false;
 }
@@ -4,19 +4,109 @@
 #include "Common.h"
 #include "Array.h"
 #include "Strings.h"
+#include "Compression.h"
+
+#include <stddef.h>
+#include <string.h>
+
+/* the byte order multi-byte values are stored in, see DataStream_SetByteOrder */
+#define DATASTREAM_BYTEORDER_HOST 0
+#define DATASTREAM_BYTEORDER_LITTLE 1
+#define DATASTREAM_BYTEORDER_BIG 2 /* network byte order */
+
+/* modes for DataStream_OpenFile */
+#define DATASTREAM_FILE_READ 0
+#define DATASTREAM_FILE_WRITE 1 /* creates the file, or truncates it */
+#define DATASTREAM_FILE_UNCACHED 2 /* or'd with either, keeps the file out of the page cache: O_DIRECT where the file system allows it, posix_fadvise otherwise */
+
+#define DATASTREAM_FILE_WINDOW 1048576 /* bytes a file stream buffers */
+#define DATASTREAM_FILE_ALIGNMENT 4096 /* the block size O_DIRECT transfers are kept to */
+
+/* field types for DataStream_Field */
+#define DATASTREAM_FIELD_INT8 0
+#define DATASTREAM_FIELD_INT16 1
+#define DATASTREAM_FIELD_INT32 2
+#define DATASTREAM_FIELD_INT64 3
+#define DATASTREAM_FIELD_UINT8 4
+#define DATASTREAM_FIELD_UINT16 5
+#define DATASTREAM_FIELD_UINT32 6
+#define DATASTREAM_FIELD_UINT64 7
+#define DATASTREAM_FIELD_FLOAT32 8
+#define DATASTREAM_FIELD_FLOAT64 9
+#define DATASTREAM_FIELD_STRING 10 /* a String member, written as by DataStream_WriteString */
+
+/**
+ * Describes one member of a struct for DataStream_WriteStruct and
+ * DataStream_ReadStruct. Build a table of them with DATASTREAM_FIELD, one
+ * entry per member to serialize, in the order they are to be written:
+ *
+ * static DataStream_Field playerFields[] = {
+ *     DATASTREAM_FIELD(Player, Id, DATASTREAM_FIELD_UINT32, 1),
+ *     DATASTREAM_FIELD(Player, Position, DATASTREAM_FIELD_FLOAT32, 1),
+ *     DATASTREAM_FIELD(Player, Name, DATASTREAM_FIELD_STRING, 1),
+ *     DATASTREAM_FIELD(Player, Score, DATASTREAM_FIELD_UINT64, 2)
+ * };
+ *
+ * A member may be a fixed-size array of its type, such as float32
+ * Position[3]. Since is the schema version the field was added in: a new
+ * version may only append fields to the end of the table.
+ */
+typedef struct {
+	uint32 Offset;
+	uint32 Length; /* size of the member in bytes */
+	uint8 Type;
+	uint32 Since;
+} DataStream_Field;
+
+#define DATASTREAM_FIELD(structType, member, type, since) { (uint32)offsetof(structType, member), (uint32)sizeof(((structType*)0)->member), (type), (since) }
+
+/* A stretch of consecutive fields that are also adjacent in the struct, and so can be copied as one block. */
+typedef struct {
+	uint32 Offset;
+	uint32 Length;
+	uint32 Since;
+	uint32 First; /* index of its first field */
+	uint32 Count;
+} DataStream_SchemaRun;
+
+typedef struct {
+	DataStream_Field* Fields;
+	DataStream_SchemaRun* Runs;
+	uint32 FieldCount;
+	uint32 RunCount;
+	uint32 Version;
+} DataStream_Schema;
 
 typedef struct {
 	Array Data;
 	uint64 Cursor;
 	boolean IsEOF;
+	uint8 ByteOrder;
+	boolean IsSwapped; /* the byte order differs from the host's */
+	int32 File; /* the descriptor of a file stream, see DataStream_OpenFile; -1 for a memory stream */
+	uint8 FileMode;
+	uint64 FileOffset; /* the position in the file of the window's first byte */
 } DataStream;
 
 export DataStream* DataStream_New(uint64 allocation);
+export DataStream* DataStream_OpenMapped(int8* path, uint8 mode);
+export DataStream* DataStream_OpenFile(int8* path, uint8 mode);
+export DataStream* DataStream_Wrap(uint8* data, uint64 length);
 export void DataStream_Initialize(DataStream* dataStream, uint64 allocation);
+export boolean DataStream_InitializeFile(DataStream* dataStream, int8* path, uint8 mode);
+export void DataStream_InitializeWrapped(DataStream* dataStream, uint8* data, uint64 length);
 export void DataStream_Free(DataStream* self);
 export void DataStream_Uninitialize(DataStream* self);
 
+export DataStream_Schema* DataStream_Schema_New(DataStream_Field* fields, uint32 count, uint32 version);
+export void DataStream_Schema_Initialize(DataStream_Schema* schema, DataStream_Field* fields, uint32 count, uint32 version);
+export void DataStream_Schema_Free(DataStream_Schema* self);
+export void DataStream_Schema_Uninitialize(DataStream_Schema* self);
+
 export void DataStream_Seek(DataStream* self, uint64 position);
+export void DataStream_SetByteOrder(DataStream* self, uint8 byteOrder);
+export void DataStream_Reserve(DataStream* self, uint64 count);
+export boolean DataStream_Flush(DataStream* self);
 
 export void DataStream_WriteInt8(DataStream* self, int8 data);
 export void DataStream_WriteInt16(DataStream* self, int16 data);
@@ -31,6 +121,18 @@ export void DataStream_WriteFloat64(DataStream* self, float64 data);
 export void DataStream_WriteBytes(DataStream* self, uint8* data, uint64 count, boolean disposeBytes);
 export void DataStream_WriteArray(DataStream* self, Array* array, boolean disposeArray);
 export void DataStream_WriteString(DataStream* self, String* string, boolean disposeString);
+export void DataStream_WriteView(DataStream* self, ArrayView view);
+export void DataStream_WriteVarUInt(DataStream* self, uint64 value);
+export void DataStream_WriteVarInt(DataStream* self, int64 value);
+export void DataStream_WriteUInt16Array(DataStream* self, uint16* values, uint64 count);
+export void DataStream_WriteUInt32Array(DataStream* self, uint32* values, uint64 count);
+export void DataStream_WriteUInt64Array(DataStream* self, uint64* values, uint64 count);
+export void DataStream_WriteFloat32Array(DataStream* self, float32* values, uint64 count);
+export void DataStream_WriteFloat64Array(DataStream* self, float64* values, uint64 count);
+export void DataStream_WriteVarUInt32Array(DataStream* self, uint32* values, uint64 count);
+export void DataStream_WriteVarInt32Array(DataStream* self, int32* values, uint64 count);
+export void DataStream_WriteStruct(DataStream* self, DataStream_Schema* schema, void* value);
+export void DataStream_Compress(DataStream* self, ArrayView source, uint32 level);
 
 export int8 DataStream_ReadInt8(DataStream* self);
 export int16 DataStream_ReadInt16(DataStream* self);
@@ -45,5 +147,62 @@ export float64 DataStream_ReadFloat64(DataStream* self);
 export uint8* DataStream_ReadBytes(DataStream* self, uint64 count);
 export Array* DataStream_ReadArray(DataStream* self, uint64 count);
 export String* DataStream_ReadString(DataStream* self);
+export ArrayView DataStream_ReadView(DataStream* self, uint64 count);
+export ArrayView DataStream_ReadStringView(DataStream* self);
+export uint64 DataStream_ReadVarUInt(DataStream* self);
+export int64 DataStream_ReadVarInt(DataStream* self);
+export boolean DataStream_ReadUInt16Array(DataStream* self, uint16* values, uint64 count);
+export boolean DataStream_ReadUInt32Array(DataStream* self, uint32* values, uint64 count);
+export boolean DataStream_ReadUInt64Array(DataStream* self, uint64* values, uint64 count);
+export boolean DataStream_ReadFloat32Array(DataStream* self, float32* values, uint64 count);
+export boolean DataStream_ReadFloat64Array(DataStream* self, float64* values, uint64 count);
+export uint64 DataStream_ReadVarUInt32Array(DataStream* self, uint32* values, uint64 capacity);
+export uint64 DataStream_ReadVarInt32Array(DataStream* self, int32* values, uint64 capacity);
+export boolean DataStream_ReadStruct(DataStream* self, DataStream_Schema* schema, void* value);
+export boolean DataStream_Decompress(DataStream* self, DataStream* output);
+
+/**
+ * Inline counterparts of the fixed-width writers and readers, for encoding
+ * and decoding many fields without a function call per value.
+ *
+ * DataStream_Put* store a value at the cursor with no growth or bounds check;
+ * reserve room for all of them first with DataStream_Reserve.
+ * DataStream_Get* make a single bounds check and otherwise behave like
+ * DataStream_Read*. Streams whose byte order differs from the host's take
+ * the exported functions instead.
+ */
+#define DATASTREAM_INLINE(name, type) \
+	static inline void DataStream_Put##name(DataStream* self, type data) { \
+		if (self->IsSwapped) { \
+			DataStream_Write##name(self, data); \
+			return; \
+		} \
+		\
+		memcpy(self->Data.Data + self->Cursor, &data, sizeof(type)); \
+		self->Cursor += sizeof(type); \
+	} \
+	\
+	static inline type DataStream_Get##name(DataStream* self) { \
+		type result; \
+		\
+		if (self->IsSwapped || sizeof(type) > self->Data.Size - self->Cursor) \
+			return DataStream_Read##name(self); \
+		\
+		memcpy(&result, self->Data.Data + self->Cursor, sizeof(type)); \
+		self->Cursor += sizeof(type); \
+		\
+		return result; \
+	}
+
+DATASTREAM_INLINE(Int8, int8)
+DATASTREAM_INLINE(Int16, int16)
+DATASTREAM_INLINE(Int32, int32)
+DATASTREAM_INLINE(Int64, int64)
+DATASTREAM_INLINE(UInt8, uint8)
+DATASTREAM_INLINE(UInt16, uint16)
+DATASTREAM_INLINE(UInt32, uint32)
+DATASTREAM_INLINE(UInt64, uint64)
+DATASTREAM_INLINE(Float32, float32)
+DATASTREAM_INLINE(Float64, float64)
 
 #endif
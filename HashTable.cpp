@@ -8,10 +8,12 @@ typedef struct Entry Entry;
 typedef struct Bucket Bucket;
 
 struct Entry {
-	uint8* Key;
+	uint8* Key; /* stored inline, directly after the entry */
 	uint8* Value;
+	uint64 Hash;
 	uint32 KeyLength;
 	uint32 ValueLength;
+	uint32 ValueAllocation;
 };
 
 struct Bucket {
@@ -22,13 +24,16 @@ struct HashTable {
 	Bucket Buckets[BUCKET_COUNT];
 };
 
-static Entry* GetEntryInBucket(Bucket* bucket, uint8* key, uint32 keyLength);
-static uint64 ComputeHash(uint8* key, uint32 keyLength);
+static void* GetHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash, void** value, uint32* valueLength);
+static void AddHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash, void* value, uint32 valueLength);
+static void RemoveHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash);
+static Entry* GetEntryInBucket(Bucket* bucket, uint8* key, uint32 keyLength, uint64 hash);
+static void DisposeEntry(void* entry);
 
 HashTable* HashTable_New() {
 	HashTable* table;
 	
-	table = Allocate(HashTable);
+	table = AllocateArrayAligned(HashTable, 1, MEMORY_CACHELINE);
 	HashTable_Initialize(table);
 
 	return table;
@@ -40,19 +45,18 @@ void HashTable_Initialize(HashTable* table) {
 	assert(table != NULL);
 
 	for (i = 0; i < BUCKET_COUNT; i++)
-		LinkedList_Initialize(&table->Buckets[i].Entries, Memory_Free);
+		LinkedList_Initialize(&table->Buckets[i].Entries, DisposeEntry);
 }
 
 void HashTable_Free(HashTable* self) {
 	HashTable_Uninitialize(self);
 
-	Free(self);
+	FreeAligned(self);
 }
 
 void HashTable_Uninitialize(HashTable* self) {
 	uint32 i;
 	Bucket* bucket;
-	Entry* entry;
 
 	assert(self != NULL);
 
@@ -60,11 +64,6 @@ void HashTable_Uninitialize(HashTable* self) {
 	i = 0;
 
 	while (i < BUCKET_COUNT) {
-		LinkedList_ForEach(entry, &bucket->Entries, Entry*) {
-			Free(entry->Key);
-			Free(entry->Value);
-		}
-
 		LinkedList_Uninitialize(&bucket->Entries);
 		bucket++;
 		i++;
@@ -72,24 +71,85 @@ void HashTable_Uninitialize(HashTable* self) {
 }
 
 void* HashTable_Get(HashTable* self, uint8* key, uint32 keyLength, void** value, uint32* valueLength) {
-	uint32 index;
-	Bucket* bucket;
-	Entry* entry;
-	
 	assert(self != NULL);
 
 	if (key == NULL)
 		return NULL;
-		
-	index = ComputeHash(key, keyLength) % BUCKET_COUNT;
+
+	return GetHashed(self, key, keyLength, String_HashBytes(key, keyLength), value, valueLength);
+}
+
+void HashTable_Add(HashTable* self, uint8* key, uint32 keyLength, void* value, uint32 valueLength) {
+	assert(self != NULL);
+
+	if (key == NULL || value == NULL)
+		return;
+
+	AddHashed(self, key, keyLength, String_HashBytes(key, keyLength), value, valueLength);
+}
+
+void HashTable_Remove(HashTable* self, uint8* key, uint32 keyLength) {
+	assert(self != NULL);
+
+	if (key == NULL)
+		return;
+
+	RemoveHashed(self, key, keyLength, String_HashBytes(key, keyLength));
+}
+
+/* The String entry points find the same entries as the byte ones for the same key bytes, but reuse the string's cached hash. */
+void* HashTable_GetString(HashTable* self, String* key, void** value, uint32* valueLength) {
+	assert(self != NULL);
+	assert(key != NULL && key->Length <= 0xFFFFFFFF);
+
+	return GetHashed(self, String_GetData(key), (uint32)key->Length, String_Hash(key), value, valueLength);
+}
+
+void HashTable_AddString(HashTable* self, String* key, void* value, uint32 valueLength) {
+	assert(self != NULL);
+	assert(key != NULL && key->Length <= 0xFFFFFFFF);
+
+	if (value == NULL)
+		return;
+
+	AddHashed(self, String_GetData(key), (uint32)key->Length, String_Hash(key), value, valueLength);
+}
+
+void HashTable_RemoveString(HashTable* self, String* key) {
+	assert(self != NULL);
+	assert(key != NULL && key->Length <= 0xFFFFFFFF);
+
+	RemoveHashed(self, String_GetData(key), (uint32)key->Length, String_Hash(key));
+}
+
+void* HashTable_GetInt(HashTable* self, uint64 key, void** value, uint32* valueLength) {
+	return HashTable_Get(self, (uint8*)&key, sizeof(key), value, valueLength);
+}
+
+void HashTable_AddInt(HashTable* self, uint64 key, void* value, uint32 valueLength) {
+	HashTable_Add(self, (uint8*)&key, sizeof(key), value, valueLength);
+}
+
+void HashTable_RemoveInt(HashTable* self, uint64 key) {
+	HashTable_Remove(self, (uint8*)&key, sizeof(key));
+}
+
+
+
+static void* GetHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash, void** value, uint32* valueLength) {
+	uint32 index;
+	Bucket* bucket;
+	Entry* entry;
+	
+	index = hash % BUCKET_COUNT;
 	bucket = self->Buckets + index;
-	entry = GetEntryInBucket(bucket, key, keyLength);
+	entry = GetEntryInBucket(bucket, key, keyLength, hash);
 
 	if (entry == NULL) {
 		if (valueLength)
 			*valueLength = 0;
 
-		if (*value)
+		if (value)
 			*value = NULL;
 
 		return NULL;
@@ -98,37 +158,40 @@ void* HashTable_Get(HashTable* self, uint8* key, uint32 keyLength, void** value,
 		if (valueLength)
 			*valueLength = entry->ValueLength;
 
-		if (*value)
+		if (value)
 			*value = entry->Value;
 
 		return entry->Value;
 	}
 }
 
-void HashTable_Add(HashTable* self, uint8* key, uint32 keyLength, void* value, uint32 valueLength) {
+static void AddHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash, void* value, uint32 valueLength) {
 	uint32 index;
 	Bucket* bucket;
 	Entry* entry;
 
-	assert(self != NULL);
-
-	if (key == NULL || value == NULL)
-		return;
-	
-	index = ComputeHash(key, keyLength) % BUCKET_COUNT;
+	index = hash % BUCKET_COUNT;
 	bucket = self->Buckets + index;
-	entry = GetEntryInBucket(bucket, key, keyLength);
+	entry = GetEntryInBucket(bucket, key, keyLength, hash);
 
 	if (entry) {
-		if (entry->ValueLength < valueLength) 
-			entry->Value = ReallocateArray(uint8, valueLength, entry->Value);
+		if (entry->ValueAllocation < valueLength) {
+			Memory_Pool_Free(entry->Value, entry->ValueAllocation);
+			entry->Value = (uint8*)Memory_Pool_Allocate(valueLength);
+			entry->ValueAllocation = valueLength;
+		}
 
+		entry->ValueLength = valueLength;
 		Memory_BlockCopy((uint8*)value, entry->Value, valueLength);
 	}
 	else {
-		entry = Allocate(Entry);
-		entry->Key = AllocateArray(uint8, keyLength);
-		entry->Value = AllocateArray(uint8, valueLength);
+		entry = (Entry*)Memory_Pool_Allocate(sizeof(Entry) + keyLength);
+		entry->Key = (uint8*)(entry + 1);
+		entry->Value = (uint8*)Memory_Pool_Allocate(valueLength);
+		entry->Hash = hash;
+		entry->KeyLength = keyLength;
+		entry->ValueLength = valueLength;
+		entry->ValueAllocation = valueLength;
 		
 		Memory_BlockCopy(key, entry->Key, keyLength);
 		Memory_BlockCopy((uint8*)value, entry->Value, valueLength);
@@ -137,56 +200,35 @@ void HashTable_Add(HashTable* self, uint8* key, uint32 keyLength, void* value, u
 	}
 }
 
-void HashTable_Remove(HashTable* self, uint8* key, uint32 keyLength) {
+static void RemoveHashed(HashTable* self, uint8* key, uint32 keyLength, uint64 hash) {
 	uint32 index;
 	Bucket* bucket;
 	Entry* entry;
 	
-	assert(self != NULL);
-
-	if (key == NULL)
-		return;
-		
-	index = ComputeHash(key, keyLength) % BUCKET_COUNT;
+	index = hash % BUCKET_COUNT;
 	bucket = self->Buckets + index;
-	entry = GetEntryInBucket(bucket, key, keyLength);
+	entry = GetEntryInBucket(bucket, key, keyLength, hash);
 
-	if (entry) {
-		Free(entry->Key);
-		Free(entry->Value);
+	if (entry)
 		LinkedList_Remove(&bucket->Entries, entry);
-	}
-}
-
-void* HashTable_GetInt(HashTable* self, uint64 key, void** value, uint32* valueLength) {
-	return HashTable_Get(self, (uint8*)&key, sizeof(key), value, valueLength);
-}
-
-void HashTable_AddInt(HashTable* self, uint64 key, void* value, uint32 valueLength) {
-	HashTable_Add(self, (uint8*)&key, sizeof(key), value, valueLength);
 }
 
-void HashTable_RemoveInt(HashTable* self, uint64 key) {
-	HashTable_Remove(self, (uint8*)&key, sizeof(key));
-}
-
-
-
-static Entry* GetEntryInBucket(Bucket* bucket, uint8* key, uint32 keyLength) {
+/* Compares the stored hash before the key bytes, so most non-matching entries are rejected without touching the key. */
+static Entry* GetEntryInBucket(Bucket* bucket, uint8* key, uint32 keyLength, uint64 hash) {
 	Entry* entry;
 
 	LinkedList_ForEach(entry, &bucket->Entries, Entry*)
-		if ( Memory_Compare(entry->Key, key, entry->KeyLength, keyLength) )
+		if (entry->Hash == hash && Memory_Compare(entry->Key, key, entry->KeyLength, keyLength))
 			return entry;
 
 	return NULL;
 }
 
-static uint64 ComputeHash(uint8* key, uint32 keyLength) {
-	uint64 hash = 5046436453;
-	
-	while (--keyLength)
-		hash = ((hash << 7) + hash) + key[keyLength];
+static void DisposeEntry(void* entry) {
+	Entry* self;
+
+	self = (Entry*)entry;
 
-	return hash;
+	Memory_Pool_Free(self->Value, self->ValueAllocation);
+	Memory_Pool_Free(self, sizeof(Entry) + self->KeyLength);
 }
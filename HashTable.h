@@ -2,6 +2,7 @@
 #define INCLUDE_UTILITIES_HASHTABLE
 
 #include "Common.h"
+#include "Strings.h"
 
 typedef struct HashTable HashTable;
 
@@ -16,6 +17,9 @@ export void HashTable_Remove(HashTable* self, uint8* key, uint32 keyLength);
 export void* HashTable_GetInt(HashTable* self, uint64 key, void** value, uint32* valueLength);
 export void HashTable_AddInt(HashTable* self, uint64 key, void* value, uint32 valueLength);
 export void HashTable_RemoveInt(HashTable* self, uint64 key);
+export void* HashTable_GetString(HashTable* self, String* key, void** value, uint32* valueLength);
+export void HashTable_AddString(HashTable* self, String* key, void* value, uint32 valueLength);
+export void HashTable_RemoveString(HashTable* self, String* key);
 
 #define HashTable_GetIntType(table, key, type) (type)HashTable_GetInt((table), (key), NULL, NULL)
 #define HashTable_AddIntType(table, key, value) HashTable_AddInt((table), (key), (void*)(value), sizeof(value))
@@ -0,0 +1,113 @@
+#ifndef INCLUDE_UTILITIES_INTRINSICS
+#define INCLUDE_UTILITIES_INTRINSICS
+
+/* Compiler intrinsics shared by the library's implementation files: atomics, thread-local storage, bit scans and the vector instruction sets used by the runtime-dispatched kernels. Not part of the public interface. */
+
+#include "Common.h"
+
+#ifdef WINDOWS
+	#include <intrin.h>
+
+	#define THREAD_LOCAL __declspec(thread)
+	#define SpinLock_Acquire(lock) while (_InterlockedExchange((volatile long*)(lock), 1)) ;
+	#define SpinLock_Release(lock) _InterlockedExchange((volatile long*)(lock), 0)
+	#define Atomic_Add64(target, value) _InterlockedExchangeAdd64((volatile int64*)(target), (int64)(value))
+	#define Atomic_CompareExchange64(target, expected, desired) ((uint64)_InterlockedCompareExchange64((volatile int64*)(target), (int64)(desired), (int64)(expected)) == (uint64)(expected))
+	#define Atomic_CompareExchange32(target, expected, desired) (_InterlockedCompareExchange((volatile long*)(target), (long)(desired), (long)(expected)) == (long)(expected))
+	#define Atomic_CompareExchangePointer(target, expected, desired) (_InterlockedCompareExchangePointer((void* volatile*)(target), (void*)(desired), (void*)(expected)) == (void*)(expected))
+	#define Atomic_Fence() _ReadWriteBarrier()
+
+	#define ByteSwap16(value) _byteswap_ushort(value)
+	#define ByteSwap32(value) _byteswap_ulong(value)
+	#define ByteSwap64(value) _byteswap_uint64(value)
+
+	static __inline uint32 CountTrailingZeros(uint32 value) {
+		unsigned long index;
+
+		_BitScanForward(&index, value);
+
+		return (uint32)index;
+	}
+
+	static __inline uint32 CountTrailingZeros64(uint64 value) {
+		unsigned long index;
+
+		_BitScanForward64(&index, value);
+
+		return (uint32)index;
+	}
+
+	static __inline uint32 CountLeadingZeros64(uint64 value) {
+		unsigned long index;
+
+		_BitScanReverse64(&index, value);
+
+		return 63 - (uint32)index;
+	}
+#else
+	#define THREAD_LOCAL __thread
+	#define SpinLock_Acquire(lock) while (__sync_lock_test_and_set((lock), 1)) ;
+	#define SpinLock_Release(lock) __sync_lock_release((lock))
+	#define Atomic_Add64(target, value) __sync_fetch_and_add((target), (value))
+	#define Atomic_CompareExchange64(target, expected, desired) __sync_bool_compare_and_swap((target), (expected), (desired))
+	#define Atomic_CompareExchange32(target, expected, desired) __sync_bool_compare_and_swap((target), (expected), (desired))
+	#define Atomic_CompareExchangePointer(target, expected, desired) __sync_bool_compare_and_swap((target), (expected), (desired))
+	#define Atomic_Fence() __sync_synchronize()
+	#define CountTrailingZeros(value) ((uint32)__builtin_ctz(value))
+	#define CountTrailingZeros64(value) ((uint32)__builtin_ctzll(value))
+	#define CountLeadingZeros64(value) ((uint32)__builtin_clzll(value))
+	#define ByteSwap16(value) __builtin_bswap16(value)
+	#define ByteSwap32(value) __builtin_bswap32(value)
+	#define ByteSwap64(value) __builtin_bswap64(value)
+#endif
+
+#if defined __SIZEOF_INT128__
+	/* returns the low half of the 128-bit product and stores the high half */
+	#define Multiply128(a, b, high) Multiply128Native((a), (b), (high))
+
+	static inline uint64 Multiply128Native(uint64 a, uint64 b, uint64* high) {
+		unsigned __int128 product;
+
+		product = (unsigned __int128)a * b;
+		*high = (uint64)(product >> 64);
+
+		return (uint64)product;
+	}
+#elif defined _M_X64
+	#define Multiply128(a, b, high) _umul128((a), (b), (high))
+#else
+	#define Multiply128(a, b, high) Multiply128Portable((a), (b), (high))
+
+	static inline uint64 Multiply128Portable(uint64 a, uint64 b, uint64* high) {
+		uint64 lowLow, lowHigh, highLow, highHigh, middle;
+
+		lowLow = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+		lowHigh = (a & 0xFFFFFFFF) * (b >> 32);
+		highLow = (a >> 32) * (b & 0xFFFFFFFF);
+		highHigh = (a >> 32) * (b >> 32);
+
+		middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) + (highLow & 0xFFFFFFFF);
+		*high = highHigh + (lowHigh >> 32) + (highLow >> 32) + (middle >> 32);
+
+		return (middle << 32) | (lowLow & 0xFFFFFFFF);
+	}
+#endif
+
+#if defined WINDOWS || defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__ || (defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	#define INTRINSICS_LITTLE_ENDIAN
+#endif
+
+#if defined _M_X64 || defined _M_IX86 || defined __x86_64__ || defined __i386__
+	#define INTRINSICS_X86
+
+	#include <immintrin.h>
+
+	/* lets a single function use an instruction set beyond the compilation baseline; MSVC needs no annotation */
+	#ifdef WINDOWS
+		#define TARGET(isa)
+	#else
+		#define TARGET(isa) __attribute__((target(isa)))
+	#endif
+#endif
+
+#endif
@@ -38,7 +38,7 @@ void LinkedList_Uninitialize(LinkedList* self) {
 
 		prior = self->First;
 		self->First = self->First->Next;
-		Free(prior);
+		PoolFree(prior, Node);
 	}
 
 	self->Count = 0;
@@ -123,7 +123,7 @@ void LinkedList_Clear(LinkedList* self) {
 
 		prior = self->First;
 		self->First = self->First->Next;
-		Free(prior);
+		PoolFree(prior, Node);
 	}
 
 	self->First = NULL;
@@ -175,7 +175,7 @@ void LinkedList_RemoveNode(LinkedList* self, Node* node) {
 	node->Data = NULL;
 	node->Prev = NULL;
 	node->Next = NULL;
-	Free(node);
+	PoolFree(node, Node);
 
 	self->Count--;
 }
@@ -185,7 +185,7 @@ void LinkedList_Prepend(LinkedList* self, void* data) {
 
 	assert(self != NULL && data != NULL);
 
-	node = Allocate(Node);
+	node = PoolAllocate(Node);
 	node->Data = data;
 	node->Prev = NULL;
 
@@ -208,7 +208,7 @@ void LinkedList_Append(LinkedList* self, void* data) {
 
 	assert(self != NULL && data != NULL);
 
-	node = Allocate(Node);
+	node = PoolAllocate(Node);
 	node->Data = data;
 	node->Next = NULL;
 
@@ -235,7 +235,7 @@ void LinkedList_Insert(LinkedList_Iterator* iterator, void* data) {
 		LinkedList_Append(iterator->List, data);
 	}
 	else {
-		node = Allocate(Node);
+		node = PoolAllocate(Node);
 		node->Data = data;
 
 		node->Prev = iterator->Position;
@@ -18,7 +18,7 @@ void List_Initialize(List* list, List_ElementDisposer elementDisposer) {
 	list->Disposer = elementDisposer;
 	list->DefaultIterator = Allocate(List_Iterator);
 	List_InitializeIterator(list->DefaultIterator, list);
-	Array_Initialize(&list->DataStore, 64);
+	PointerVector_Initialize(&list->DataStore, 8);
 }
 
 void List_Free(List* self) {
@@ -42,23 +42,18 @@ void List_Uninitialize(List* self) {
 	self->Cursor = 0;
 	self->Disposer = NULL;
 	Free(self->DefaultIterator);
-	Array_Uninitialize(&self->DataStore);
+	PointerVector_Uninitialize(&self->DataStore);
 }
 
 void List_Append(List* self, void* data) {
-	uint64 address;
-
 	assert(self != NULL && data != NULL);
-	
-	address = (uint64)data;
 
-	Array_Write(&self->DataStore, (uint8*)&address, self->Count * sizeof(void*), sizeof(void*));
+	PointerVector_Push(&self->DataStore, data);
 
 	self->Count++;
 }
 
 void* List_Iterate(List_Iterator* iterator) {
-	uint64 data;
 	void* address;
 
 	assert(iterator != NULL);
@@ -66,8 +61,7 @@ void* List_Iterate(List_Iterator* iterator) {
 	address = NULL;
 
 	if (iterator->Position < iterator->ParentList->Count) {
-		data = *(uint64*)Array_Read(&iterator->ParentList->DataStore, iterator->Position * sizeof(void*), sizeof(void*));
-		address = (void*)data;
+		address = PointerVector_At(&iterator->ParentList->DataStore, iterator->Position);
 		iterator->Position++;
 	}
 
@@ -2,7 +2,7 @@
 #define INCLUDE_UTILITIES_LIST
 
 #include "Common.h"
-#include "Array.h"
+#include "Vector.h"
 
 typedef void (*List_ElementDisposer)(void*);
 
@@ -11,7 +11,7 @@ typedef struct List List;
 typedef struct List_Iterator List_Iterator;
 
 struct List {
-	Array DataStore;
+	PointerVector DataStore;
 	uint64 Cursor;
 	uint64 Count;
 	List_Iterator* DefaultIterator;
@@ -1,8 +1,38 @@
+/* for mremap */
+#ifndef _GNU_SOURCE
+	#define _GNU_SOURCE
+#endif
+
 #include "Memory.h"
-#include "LinkedList.h"
-#include "Strings.h"
 
 #include <stdlib.h>
+#include <stdio.h>
+
+#ifdef WINDOWS
+	#define WIN32_LEAN_AND_MEAN
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+#endif
+
+#include "Intrinsics.h"
+
+#ifdef INTRINSICS_X86
+	#define MOVE_CHUNK 16
+	typedef __m128i MoveChunk;
+	#define Move_Load(pointer) _mm_loadu_si128((__m128i*)(pointer))
+	#define Move_Store(pointer, value) _mm_storeu_si128((__m128i*)(pointer), (value))
+#else
+	#define MOVE_CHUNK 8
+	typedef uint64 MoveChunk;
+	#define Move_Load(pointer) (*(uint64*)(pointer))
+	#define Move_Store(pointer, value) (*(uint64*)(pointer) = (value))
+#endif
+
+#define MEMORY_STREAMING_THRESHOLD (4 * 1024 * 1024)
 
 
 #ifdef NDEBUG
@@ -17,20 +47,222 @@ void* Memory_Reallocate(void* block, uint64 size) {
 
 #else
 
-LinkedList* allocations;
-static boolean allocationsInitialized = false;
+#define PROFILER_SITE_COUNT 4096
+#define PROFILER_HEADER_MAGIC 0x4D454D50524F4649ULL
+
+#define PROFILER_SLOT_EMPTY 0
+#define PROFILER_SLOT_CLAIMED 1
+#define PROFILER_SLOT_READY 2
+
+typedef struct {
+	volatile int32 State;
+	Memory_CallSite Site;
+} ProfilerSlot;
+
+/* Prepended to every allocation made through Memory_AllocateD so that Memory_Free can credit the right callsite. */
+typedef struct {
+	ProfilerSlot* Slot;
+	uint64 Size;
+	uint64 Magic;
+	uint64 Reserved;
+} ProfilerHeader;
+
+static ProfilerSlot profilerSlots[PROFILER_SITE_COUNT];
+static ProfilerSlot profilerOverflow = { PROFILER_SLOT_READY, { "<overflow>", 0, 0, 0, 0, 0, 0 } };
+static volatile int32 profilerExitRegistered = false;
+
+static void Memory_Profiler_OnExit(void) {
+	Memory_Profiler_ReportLeaks();
+}
+
+/* Finds or claims the slot for a callsite without taking a lock. A slot is claimed by one CAS on its state; other threads that probe a slot being claimed spin until it is published. */
+static ProfilerSlot* Memory_Profiler_FindSlot(int8* file, uint64 line) {
+	ProfilerSlot* slot;
+	uint64 hash;
+	uint32 probes;
+
+	if (!profilerExitRegistered && Atomic_CompareExchange32(&profilerExitRegistered, false, true))
+		atexit(Memory_Profiler_OnExit);
+
+	hash = ((uint64)file ^ (line * 0x9E3779B97F4A7C15ULL)) * 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 29;
+
+	for (probes = 0; probes < PROFILER_SITE_COUNT; probes++) {
+		slot = profilerSlots + ((hash + probes) & (PROFILER_SITE_COUNT - 1));
+
+		if (slot->State == PROFILER_SLOT_EMPTY && Atomic_CompareExchange32(&slot->State, PROFILER_SLOT_EMPTY, PROFILER_SLOT_CLAIMED)) {
+			slot->Site.File = file;
+			slot->Site.Line = line;
+			Atomic_Fence();
+			slot->State = PROFILER_SLOT_READY;
+			return slot;
+		}
+
+		while (slot->State == PROFILER_SLOT_CLAIMED)
+			;
+
+		if (slot->Site.File == file && slot->Site.Line == line)
+			return slot;
+	}
+
+	return &profilerOverflow;
+}
+
+static void Memory_Profiler_Record(ProfilerSlot* slot, uint64 size) {
+	uint64 live;
+	uint64 peak;
+
+	Atomic_Add64(&slot->Site.Count, 1);
+	Atomic_Add64(&slot->Site.Bytes, size);
+	Atomic_Add64(&slot->Site.LiveCount, 1);
+	live = Atomic_Add64(&slot->Site.LiveBytes, size) + size;
+
+	do
+		peak = slot->Site.PeakBytes;
+	while (live > peak && !Atomic_CompareExchange64(&slot->Site.PeakBytes, peak, live));
+}
+
+static void Memory_Profiler_Release(ProfilerHeader* header) {
+	Atomic_Add64(&header->Slot->Site.LiveCount, (uint64)-1);
+	Atomic_Add64(&header->Slot->Site.LiveBytes, (uint64)0 - header->Size);
+}
 
-//add a record of the allocation to allocations and remove it on FreeD()
 void* Memory_AllocateD(uint64 size, uint64 line, int8* file) {
-	/*if (!allocationsInitialized) allocations = LinkedList_New( ( void(*)(void*) ) String_Free);*/
+	ProfilerHeader* header;
 
-	return malloc(size);
+	header = (ProfilerHeader*)malloc(sizeof(ProfilerHeader) + size);
+	if (header == NULL)
+		return NULL;
+
+	header->Slot = Memory_Profiler_FindSlot(file, line);
+	header->Size = size;
+	header->Magic = PROFILER_HEADER_MAGIC;
+	Memory_Profiler_Record(header->Slot, size);
+
+	return header + 1;
 }
 
 void* Memory_ReallocateD(void* block, uint64 size, uint64 line, int8* file) {
-	/*if (!allocationsInitialized) allocations = LinkedList_New( ( void(*)(void*) ) String_Free);*/
+	ProfilerHeader* header;
 
-	return realloc(block, size);
+	if (block == NULL)
+		return Memory_AllocateD(size, line, file);
+
+	header = (ProfilerHeader*)block - 1;
+	assert(header->Magic == PROFILER_HEADER_MAGIC);
+
+	Memory_Profiler_Release(header);
+	header = (ProfilerHeader*)realloc(header, sizeof(ProfilerHeader) + size);
+	if (header == NULL)
+		return NULL;
+
+	header->Slot = Memory_Profiler_FindSlot(file, line);
+	header->Size = size;
+	Memory_Profiler_Record(header->Slot, size);
+
+	return header + 1;
+}
+
+/**
+ * Copies the current counters of every callsite that has allocated memory.
+ *
+ * @returns a snapshot to be released with Memory_Profiler_FreeSnapshot
+ */
+Memory_Snapshot* Memory_Profiler_TakeSnapshot(void) {
+	Memory_Snapshot* snapshot;
+	uint32 i;
+
+	snapshot = (Memory_Snapshot*)malloc(sizeof(Memory_Snapshot));
+	snapshot->Sites = (Memory_CallSite*)malloc(sizeof(Memory_CallSite) * (PROFILER_SITE_COUNT + 1));
+	snapshot->Count = 0;
+
+	for (i = 0; i < PROFILER_SITE_COUNT; i++)
+		if (profilerSlots[i].State == PROFILER_SLOT_READY)
+			snapshot->Sites[snapshot->Count++] = profilerSlots[i].Site;
+
+	if (profilerOverflow.Site.Count != 0)
+		snapshot->Sites[snapshot->Count++] = profilerOverflow.Site;
+
+	return snapshot;
+}
+
+/**
+ * Computes the growth between two snapshots. Count and Bytes hold the allocations
+ * made in between, LiveCount and LiveBytes the change in retained memory (as a
+ * two's complement difference), and PeakBytes the peak in @a after. Callsites
+ * that did not change are omitted.
+ *
+ * @returns a snapshot to be released with Memory_Profiler_FreeSnapshot
+ */
+Memory_Snapshot* Memory_Profiler_Diff(Memory_Snapshot* before, Memory_Snapshot* after) {
+	Memory_Snapshot* diff;
+	Memory_CallSite* site;
+	uint32 i;
+	uint32 j;
+
+	assert(before != NULL && after != NULL);
+
+	diff = (Memory_Snapshot*)malloc(sizeof(Memory_Snapshot));
+	diff->Sites = (Memory_CallSite*)malloc(sizeof(Memory_CallSite) * (after->Count + 1));
+	diff->Count = 0;
+
+	for (i = 0; i < after->Count; i++) {
+		site = diff->Sites + diff->Count;
+		*site = after->Sites[i];
+
+		for (j = 0; j < before->Count; j++) {
+			if (before->Sites[j].File == site->File && before->Sites[j].Line == site->Line) {
+				site->Count -= before->Sites[j].Count;
+				site->Bytes -= before->Sites[j].Bytes;
+				site->LiveCount -= before->Sites[j].LiveCount;
+				site->LiveBytes -= before->Sites[j].LiveBytes;
+				break;
+			}
+		}
+
+		if (site->Count != 0 || site->LiveCount != 0)
+			diff->Count++;
+	}
+
+	return diff;
+}
+
+void Memory_Profiler_FreeSnapshot(Memory_Snapshot* snapshot) {
+	assert(snapshot != NULL);
+
+	free(snapshot->Sites);
+	free(snapshot);
+}
+
+/**
+ * Writes one line per callsite in @a snapshot to stderr.
+ */
+void Memory_Profiler_Report(Memory_Snapshot* snapshot) {
+	Memory_CallSite* site;
+	uint32 i;
+
+	assert(snapshot != NULL);
+
+	for (i = 0; i < snapshot->Count; i++) {
+		site = snapshot->Sites + i;
+		fprintf(stderr, "%s:%llu count=%llu bytes=%llu live=%lld/%lld peak=%llu\n", site->File, site->Line, site->Count, site->Bytes, (int64)site->LiveCount, (int64)site->LiveBytes, site->PeakBytes);
+	}
+}
+
+/**
+ * Writes every callsite that still has live allocations to stderr. Registered
+ * to run at exit on the first allocation.
+ */
+void Memory_Profiler_ReportLeaks(void) {
+	Memory_CallSite* site;
+	uint32 i;
+
+	for (i = 0; i < PROFILER_SITE_COUNT; i++) {
+		site = &profilerSlots[i].Site;
+
+		if (profilerSlots[i].State == PROFILER_SLOT_READY && site->LiveCount != 0)
+			fprintf(stderr, "leak: %s:%llu %llu blocks, %llu bytes\n", site->File, site->Line, site->LiveCount, site->LiveBytes);
+	}
 }
 
 #endif
@@ -40,29 +272,1265 @@ void Memory_Free(void* block) {
 #ifdef NDEBUG
 	free(block);
 #else
-	free(block);
+	ProfilerHeader* header;
+
+	if (block == NULL)
+		return;
+
+	/* every block passed here must come from Memory_AllocateD; blocks from other libraries go to their own free */
+	header = (ProfilerHeader*)block - 1;
+	assert(header->Magic == PROFILER_HEADER_MAGIC);
+
+	header->Magic = 0;
+	Memory_Profiler_Release(header);
+	free(header);
 #endif
 }
 
+/* Copies fewer than 16 bytes. Every load happens before the first store so overlapping blocks are safe. */
+static void Memory_CopySmall(uint8* source, uint8* destination, uint64 amount) {
+	uint64 head64, tail64;
+	uint32 head32, tail32;
+	uint16 head16, tail16;
+
+	if (amount >= 8) {
+		head64 = *(uint64*)source;
+		tail64 = *(uint64*)(source + amount - 8);
+		*(uint64*)destination = head64;
+		*(uint64*)(destination + amount - 8) = tail64;
+	}
+	else if (amount >= 4) {
+		head32 = *(uint32*)source;
+		tail32 = *(uint32*)(source + amount - 4);
+		*(uint32*)destination = head32;
+		*(uint32*)(destination + amount - 4) = tail32;
+	}
+	else if (amount >= 2) {
+		head16 = *(uint16*)source;
+		tail16 = *(uint16*)(source + amount - 2);
+		*(uint16*)destination = head16;
+		*(uint16*)(destination + amount - 2) = tail16;
+	}
+	else if (amount == 1) {
+		*destination = *source;
+	}
+}
+
+#ifdef INTRINSICS_X86
+
+/* The kernels below handle amount >= 16. Each copies whole vectors front to back and finishes with one unaligned vector ending exactly at the last byte. */
+
+static void TARGET("sse2") Memory_BlockCopySSE2(uint8* source, uint8* destination, uint64 amount) {
+	__m128i tail;
+	uint8* end;
+	uint64 offset;
+
+	tail = _mm_loadu_si128((__m128i*)(source + amount - 16));
+	end = destination + amount - 16;
+
+	if (amount >= MEMORY_STREAMING_THRESHOLD) {
+		_mm_storeu_si128((__m128i*)destination, _mm_loadu_si128((__m128i*)source));
+		offset = 16 - ((uint64)destination & 15);
+		source += offset;
+		destination += offset;
+		amount -= offset;
+
+		for (; amount > 16; amount -= 16, source += 16, destination += 16)
+			_mm_stream_si128((__m128i*)destination, _mm_loadu_si128((__m128i*)source));
+
+		_mm_sfence();
+	}
+	else {
+		for (; amount > 16; amount -= 16, source += 16, destination += 16)
+			_mm_storeu_si128((__m128i*)destination, _mm_loadu_si128((__m128i*)source));
+	}
+
+	_mm_storeu_si128((__m128i*)end, tail);
+}
+
+static void TARGET("avx2") Memory_BlockCopyAVX2(uint8* source, uint8* destination, uint64 amount) {
+	__m256i tail;
+	__m128i head128, tail128;
+	uint8* end;
+	uint64 offset;
+
+	if (amount <= 32) {
+		head128 = _mm_loadu_si128((__m128i*)source);
+		tail128 = _mm_loadu_si128((__m128i*)(source + amount - 16));
+		_mm_storeu_si128((__m128i*)destination, head128);
+		_mm_storeu_si128((__m128i*)(destination + amount - 16), tail128);
+		return;
+	}
+
+	tail = _mm256_loadu_si256((__m256i*)(source + amount - 32));
+	end = destination + amount - 32;
+
+	if (amount >= MEMORY_STREAMING_THRESHOLD) {
+		_mm256_storeu_si256((__m256i*)destination, _mm256_loadu_si256((__m256i*)source));
+		offset = 32 - ((uint64)destination & 31);
+		source += offset;
+		destination += offset;
+		amount -= offset;
+
+		for (; amount > 32; amount -= 32, source += 32, destination += 32)
+			_mm256_stream_si256((__m256i*)destination, _mm256_loadu_si256((__m256i*)source));
+
+		_mm_sfence();
+	}
+	else {
+		for (; amount > 32; amount -= 32, source += 32, destination += 32)
+			_mm256_storeu_si256((__m256i*)destination, _mm256_loadu_si256((__m256i*)source));
+	}
+
+	_mm256_storeu_si256((__m256i*)end, tail);
+}
+
+static void TARGET("avx512f,avx2") Memory_BlockCopyAVX512(uint8* source, uint8* destination, uint64 amount) {
+	__m512i tail;
+	__m256i head256, tail256;
+	uint8* end;
+	uint64 offset;
+
+	if (amount <= 32) {
+		Memory_BlockCopyAVX2(source, destination, amount);
+		return;
+	}
+
+	if (amount <= 64) {
+		head256 = _mm256_loadu_si256((__m256i*)source);
+		tail256 = _mm256_loadu_si256((__m256i*)(source + amount - 32));
+		_mm256_storeu_si256((__m256i*)destination, head256);
+		_mm256_storeu_si256((__m256i*)(destination + amount - 32), tail256);
+		return;
+	}
+
+	tail = _mm512_loadu_si512((void*)(source + amount - 64));
+	end = destination + amount - 64;
+
+	if (amount >= MEMORY_STREAMING_THRESHOLD) {
+		_mm512_storeu_si512((void*)destination, _mm512_loadu_si512((void*)source));
+		offset = 64 - ((uint64)destination & 63);
+		source += offset;
+		destination += offset;
+		amount -= offset;
+
+		for (; amount > 64; amount -= 64, source += 64, destination += 64)
+			_mm512_stream_si512((void*)destination, _mm512_loadu_si512((void*)source));
+
+		_mm_sfence();
+	}
+	else {
+		for (; amount > 64; amount -= 64, source += 64, destination += 64)
+			_mm512_storeu_si512((void*)destination, _mm512_loadu_si512((void*)source));
+	}
+
+	_mm512_storeu_si512((void*)end, tail);
+}
+
+#else
+
+static void Memory_BlockCopyScalar(uint8* source, uint8* destination, uint64 amount) {
+	uint64 tail;
+	uint8* end;
+
+	tail = *(uint64*)(source + amount - 8);
+	end = destination + amount - 8;
+
+	for (; amount > 8; amount -= 8, source += 8, destination += 8)
+		*(uint64*)destination = *(uint64*)source;
+
+	*(uint64*)end = tail;
+}
+
+#endif
+
+static void Memory_BlockCopyResolve(uint8* source, uint8* destination, uint64 amount);
+
+static void (*blockCopyKernel)(uint8* source, uint8* destination, uint64 amount) = Memory_BlockCopyResolve;
+
+/* Picks the widest copy kernel the CPU supports on first use. */
+static void Memory_BlockCopyResolve(uint8* source, uint8* destination, uint64 amount) {
+#ifdef INTRINSICS_X86
+	uint32 features;
+
+	features = Memory_GetCPUFeatures();
+
+	if (features & MEMORY_CPU_AVX512)
+		blockCopyKernel = Memory_BlockCopyAVX512;
+	else if (features & MEMORY_CPU_AVX2)
+		blockCopyKernel = Memory_BlockCopyAVX2;
+	else
+		blockCopyKernel = Memory_BlockCopySSE2;
+#else
+	blockCopyKernel = Memory_BlockCopyScalar;
+#endif
+
+	blockCopyKernel(source, destination, amount);
+}
+
+/**
+ * @returns a mask of MEMORY_CPU_* flags for the vector extensions the CPU and
+ * operating system support. The result is computed once.
+ */
+uint32 Memory_GetCPUFeatures(void) {
+	static volatile int32 features = -1;
+#ifdef INTRINSICS_X86
+	uint32 result;
+#ifdef WINDOWS
+	int32 registers[4];
+	boolean osSavesYMM;
+	boolean osSavesZMM;
+#endif
+
+	if (features != -1)
+		return (uint32)features;
+
+	result = MEMORY_CPU_SSE2;
+
+#ifdef WINDOWS
+	__cpuid(registers, 1);
+	if (registers[2] & (1 << 19))
+		result |= MEMORY_CPU_SSE41;
+
+	if ((registers[2] & (1 << 27)) && (registers[2] & (1 << 28))) {
+		osSavesYMM = (_xgetbv(0) & 0x6) == 0x6;
+		osSavesZMM = (_xgetbv(0) & 0xE6) == 0xE6;
+
+		__cpuidex(registers, 7, 0);
+		if (osSavesYMM && (registers[1] & (1 << 5)))
+			result |= MEMORY_CPU_AVX2;
+		if (osSavesZMM && (registers[1] & (1 << 16)) && (registers[1] & (1 << 30)))
+			result |= MEMORY_CPU_AVX512;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("sse4.1"))
+		result |= MEMORY_CPU_SSE41;
+	if (__builtin_cpu_supports("avx2"))
+		result |= MEMORY_CPU_AVX2;
+	if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+		result |= MEMORY_CPU_AVX512;
+#endif
+
+	features = (int32)result;
+#else
+	features = 0;
+#endif
+
+	return (uint32)features;
+}
+
+/**
+ * Copies @a amount bytes from @a source to @a destination. The blocks must not
+ * overlap; use Memory_Move when they might. Copies of 4 MiB or more bypass the
+ * cache with non-temporal stores.
+ */
 void Memory_BlockCopy(uint8* source, uint8* destination, uint64 amount) {
-	uint8 i;
+	if (amount < 16)
+		Memory_CopySmall(source, destination, amount);
+	else
+		blockCopyKernel(source, destination, amount);
+}
+
+/**
+ * Copies @a amount bytes from @a source to @a destination. The blocks may
+ * overlap; the result is as if @a source were first copied to a temporary buffer.
+ */
+void Memory_Move(uint8* source, uint8* destination, uint64 amount) {
+	MoveChunk head;
+	MoveChunk tail;
+	uint64 i;
+
+	if (source == destination || amount == 0)
+		return;
+
+	if (amount < 16) {
+		Memory_CopySmall(source, destination, amount);
+		return;
+	}
+
+	if (destination + amount <= source || source + amount <= destination) {
+		blockCopyKernel(source, destination, amount);
+		return;
+	}
+
+	if (destination < source) {
+		tail = Move_Load(source + amount - MOVE_CHUNK);
+
+		for (i = 0; i + MOVE_CHUNK < amount; i += MOVE_CHUNK)
+			Move_Store(destination + i, Move_Load(source + i));
+
+		Move_Store(destination + amount - MOVE_CHUNK, tail);
+	}
+	else {
+		head = Move_Load(source);
+
+		for (i = amount; i > MOVE_CHUNK; i -= MOVE_CHUNK)
+			Move_Store(destination + i - MOVE_CHUNK, Move_Load(source + i - MOVE_CHUNK));
+
+		Move_Store(destination, head);
+	}
+}
+
+static uint64 Memory_Mismatch(uint8* blockA, uint8* blockB, uint64 length);
+
+#ifdef INTRINSICS_X86
+
+/* Returns the index of the first differing byte, or length if the blocks are equal. length must be at least 16. */
+static uint64 TARGET("sse2") Memory_MismatchSSE2(uint8* blockA, uint8* blockB, uint64 length) {
+	uint32 mask;
+	uint64 i;
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		mask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(blockA + i)), _mm_loadu_si128((__m128i*)(blockB + i)))) ^ 0xFFFF;
+		if (mask)
+			return i + CountTrailingZeros(mask);
+	}
+
+	if (i < length) {
+		i = length - 16;
+		mask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(blockA + i)), _mm_loadu_si128((__m128i*)(blockB + i)))) ^ 0xFFFF;
+		if (mask)
+			return i + CountTrailingZeros(mask);
+	}
+
+	return length;
+}
+
+static uint64 TARGET("avx2") Memory_MismatchAVX2(uint8* blockA, uint8* blockB, uint64 length) {
+	uint32 mask;
+	uint64 i;
 
-	if (amount > 0) {
-		for (; amount >= 8; amount -= 8) 
-			*(uint64*)(destination + amount - 8) = *(uint64*)(source + amount - 8);
+	if (length < 32)
+		return Memory_MismatchSSE2(blockA, blockB, length);
 
-		for (i = 0; i < amount; i++)
-			*(uint8*)(destination + i) = *(source + i);
+	for (i = 0; i + 32 <= length; i += 32) {
+		mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(blockA + i)), _mm256_loadu_si256((__m256i*)(blockB + i))));
+		if (mask)
+			return i + CountTrailingZeros(mask);
 	}
+
+	if (i < length) {
+		i = length - 32;
+		mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(blockA + i)), _mm256_loadu_si256((__m256i*)(blockB + i))));
+		if (mask)
+			return i + CountTrailingZeros(mask);
+	}
+
+	return length;
+}
+
+static uint8* TARGET("sse2") Memory_FindByteSSE2(uint8* block, uint64 length, uint8 value) {
+	__m128i needle;
+	uint32 mask;
+	uint64 i;
+
+	needle = _mm_set1_epi8((int8)value);
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		mask = (uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(block + i)), needle));
+		if (mask)
+			return block + i + CountTrailingZeros(mask);
+	}
+
+	for (; i < length; i++)
+		if (block[i] == value)
+			return block + i;
+
+	return NULL;
+}
+
+static uint8* TARGET("avx2") Memory_FindByteAVX2(uint8* block, uint64 length, uint8 value) {
+	__m256i needle;
+	uint32 mask;
+	uint64 i;
+
+	needle = _mm256_set1_epi8((int8)value);
+
+	for (i = 0; i + 32 <= length; i += 32) {
+		mask = (uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(block + i)), needle));
+		if (mask)
+			return block + i + CountTrailingZeros(mask);
+	}
+
+	return i < length ? Memory_FindByteSSE2(block + i, length - i, value) : NULL;
+}
+
+/* Compares the first and last needle bytes against 16 (or 32) haystack positions at once and only verifies the full needle where both match. needleLength must be at least 2. */
+static uint8* TARGET("sse2") Memory_FindBytesSSE2(uint8* block, uint64 length, uint8* needle, uint64 needleLength) {
+	__m128i first;
+	__m128i last;
+	uint32 mask;
+	uint64 i;
+	uint32 bit;
+
+	first = _mm_set1_epi8((int8)needle[0]);
+	last = _mm_set1_epi8((int8)needle[needleLength - 1]);
+
+	for (i = 0; i + needleLength - 1 + 16 <= length; i += 16) {
+		mask = (uint32)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(block + i)), first), _mm_cmpeq_epi8(_mm_loadu_si128((__m128i*)(block + i + needleLength - 1)), last)));
+
+		while (mask) {
+			bit = CountTrailingZeros(mask);
+			if (Memory_Mismatch(block + i + bit + 1, needle + 1, needleLength - 2) == needleLength - 2)
+				return block + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	for (; i + needleLength <= length; i++)
+		if (block[i] == needle[0] && Memory_Mismatch(block + i + 1, needle + 1, needleLength - 1) == needleLength - 1)
+			return block + i;
+
+	return NULL;
+}
+
+static uint8* TARGET("avx2") Memory_FindBytesAVX2(uint8* block, uint64 length, uint8* needle, uint64 needleLength) {
+	__m256i first;
+	__m256i last;
+	uint32 mask;
+	uint64 i;
+	uint32 bit;
+
+	first = _mm256_set1_epi8((int8)needle[0]);
+	last = _mm256_set1_epi8((int8)needle[needleLength - 1]);
+
+	for (i = 0; i + needleLength - 1 + 32 <= length; i += 32) {
+		mask = (uint32)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(block + i)), first), _mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i*)(block + i + needleLength - 1)), last)));
+
+		while (mask) {
+			bit = CountTrailingZeros(mask);
+			if (Memory_Mismatch(block + i + bit + 1, needle + 1, needleLength - 2) == needleLength - 2)
+				return block + i + bit;
+			mask &= mask - 1;
+		}
+	}
+
+	return i < length ? Memory_FindBytesSSE2(block + i, length - i, needle, needleLength) : NULL;
+}
+
+#else
+
+static uint64 Memory_MismatchScalar(uint8* blockA, uint8* blockB, uint64 length) {
+	uint64 i;
+
+	for (i = 0; i + 8 <= length; i += 8)
+		if (*(uint64*)(blockA + i) != *(uint64*)(blockB + i))
+			break;
+
+	for (; i < length; i++)
+		if (blockA[i] != blockB[i])
+			return i;
+
+	return length;
+}
+
+static uint8* Memory_FindByteScalar(uint8* block, uint64 length, uint8 value) {
+	uint64 i;
+
+	for (i = 0; i < length; i++)
+		if (block[i] == value)
+			return block + i;
+
+	return NULL;
+}
+
+static uint8* Memory_FindBytesScalar(uint8* block, uint64 length, uint8* needle, uint64 needleLength) {
+	uint8* candidate;
+	uint8* end;
+
+	end = block + length - needleLength + 1;
+
+	for (candidate = block; (candidate = Memory_FindByteScalar(candidate, (uint64)(end - candidate), needle[0])) != NULL; candidate++)
+		if (Memory_MismatchScalar(candidate + 1, needle + 1, needleLength - 1) == needleLength - 1)
+			return candidate;
+
+	return NULL;
+}
+
+#endif
+
+static uint64 Memory_MismatchResolve(uint8* blockA, uint8* blockB, uint64 length);
+static uint8* Memory_FindByteResolve(uint8* block, uint64 length, uint8 value);
+static uint8* Memory_FindBytesResolve(uint8* block, uint64 length, uint8* needle, uint64 needleLength);
+
+static uint64 (*mismatchKernel)(uint8* blockA, uint8* blockB, uint64 length) = Memory_MismatchResolve;
+static uint8* (*findByteKernel)(uint8* block, uint64 length, uint8 value) = Memory_FindByteResolve;
+static uint8* (*findBytesKernel)(uint8* block, uint64 length, uint8* needle, uint64 needleLength) = Memory_FindBytesResolve;
+
+static void Memory_ResolveSearchKernels(void) {
+#ifdef INTRINSICS_X86
+	if (Memory_GetCPUFeatures() & MEMORY_CPU_AVX2) {
+		mismatchKernel = Memory_MismatchAVX2;
+		findByteKernel = Memory_FindByteAVX2;
+		findBytesKernel = Memory_FindBytesAVX2;
+	}
+	else {
+		mismatchKernel = Memory_MismatchSSE2;
+		findByteKernel = Memory_FindByteSSE2;
+		findBytesKernel = Memory_FindBytesSSE2;
+	}
+#else
+	mismatchKernel = Memory_MismatchScalar;
+	findByteKernel = Memory_FindByteScalar;
+	findBytesKernel = Memory_FindBytesScalar;
+#endif
 }
 
+static uint64 Memory_MismatchResolve(uint8* blockA, uint8* blockB, uint64 length) {
+	Memory_ResolveSearchKernels();
+	return mismatchKernel(blockA, blockB, length);
+}
+
+static uint8* Memory_FindByteResolve(uint8* block, uint64 length, uint8 value) {
+	Memory_ResolveSearchKernels();
+	return findByteKernel(block, length, value);
+}
+
+static uint8* Memory_FindBytesResolve(uint8* block, uint64 length, uint8* needle, uint64 needleLength) {
+	Memory_ResolveSearchKernels();
+	return findBytesKernel(block, length, needle, needleLength);
+}
+
+/* Returns the index of the first byte where the blocks differ, or length if they are equal. */
+static uint64 Memory_Mismatch(uint8* blockA, uint8* blockB, uint64 length) {
+	uint64 i;
+
+	if (length >= 16)
+		return mismatchKernel(blockA, blockB, length);
+
+	for (i = 0; i < length; i++)
+		if (blockA[i] != blockB[i])
+			return i;
+
+	return length;
+}
+
+/**
+ * @returns true if both blocks have the same length and contents.
+ */
 boolean Memory_Compare(uint8* blockA, uint8* blockB, uint64 lengthA, uint64 lengthB) {
 	if (lengthA != lengthB)
 		return false;
 
-	for (; lengthA > 0; lengthA--)
-		if (blockA[lengthA - 1] != blockB[lengthA - 1])
-			return false;
+	if (blockA == blockB)
+		return true;
+
+	if (lengthA >= 8 && lengthA <= 16)
+		return *(uint64*)blockA == *(uint64*)blockB && *(uint64*)(blockA + lengthA - 8) == *(uint64*)(blockB + lengthA - 8);
+
+	return Memory_Mismatch(blockA, blockB, lengthA) == lengthA;
+}
+
+/**
+ * Orders two blocks lexicographically by unsigned byte value; a block that is a
+ * prefix of the other sorts first.
+ *
+ * @returns a negative value, zero or a positive value if @a blockA sorts before,
+ * equal to or after @a blockB
+ */
+int32 Memory_CompareOrder(uint8* blockA, uint8* blockB, uint64 lengthA, uint64 lengthB) {
+	uint64 index;
+
+	index = Memory_Mismatch(blockA, blockB, lengthA < lengthB ? lengthA : lengthB);
+
+	if (index < lengthA && index < lengthB)
+		return (int32)blockA[index] - (int32)blockB[index];
+
+	return lengthA == lengthB ? 0 : (lengthA < lengthB ? -1 : 1);
+}
+
+/**
+ * @returns a pointer to the first occurrence of @a value in @a block, or NULL.
+ */
+uint8* Memory_FindByte(uint8* block, uint64 length, uint8 value) {
+	uint64 i;
+
+	assert(block != NULL || length == 0);
+
+	if (length >= 16)
+		return findByteKernel(block, length, value);
+
+	for (i = 0; i < length; i++)
+		if (block[i] == value)
+			return block + i;
+
+	return NULL;
+}
+
+/**
+ * @returns a pointer to the first occurrence of @a needle in @a block, or NULL.
+ * An empty needle matches at the start of @a block.
+ */
+uint8* Memory_FindBytes(uint8* block, uint64 length, uint8* needle, uint64 needleLength) {
+	assert(block != NULL || length == 0);
+	assert(needle != NULL || needleLength == 0);
+
+	if (needleLength == 0)
+		return block;
+
+	if (needleLength > length)
+		return NULL;
+
+	if (needleLength == 1)
+		return Memory_FindByte(block, length, needle[0]);
+
+	return findBytesKernel(block, length, needle, needleLength);
+}
+
+/**
+ * Allocates a block whose address is a multiple of @a alignment.
+ *
+ * @param size Size in bytes of the block
+ * @param alignment Required alignment, a power of two
+ * @returns pointer to the block, to be released with Memory_FreeAligned
+ */
+void* Memory_AllocateAligned(uint64 size, uint64 alignment) {
+	uint8* raw;
+	uint8* result;
+
+	assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+	if (alignment < sizeof(void*))
+		alignment = sizeof(void*);
+
+	raw = AllocateArray(uint8, size + alignment - 1 + sizeof(void*));
+	if (raw == NULL)
+		return NULL;
+
+	result = (uint8*)(((uint64)(raw + sizeof(void*)) + alignment - 1) & ~(alignment - 1));
+	((void**)result)[-1] = raw;
+
+	return result;
+}
+
+/**
+ * Frees a block allocated by Memory_AllocateAligned.
+ */
+void Memory_FreeAligned(void* block) {
+	if (block != NULL)
+		Free(((void**)block)[-1]);
+}
+
+static uint64 Memory_GetPageSize(void) {
+	static uint64 pageSize = 0;
+#ifdef WINDOWS
+	SYSTEM_INFO info;
+#endif
+
+	if (pageSize == 0) {
+#ifdef WINDOWS
+		GetSystemInfo(&info);
+		pageSize = info.dwPageSize;
+#else
+		pageSize = (uint64)sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	return pageSize;
+}
+
+/* Rounds a page allocation up to whole pages, or whole huge pages once it is large enough to use them. */
+static uint64 Memory_RoundPages(uint64 size) {
+	uint64 granularity;
+
+	granularity = size >= MEMORY_HUGEPAGE_SIZE ? MEMORY_HUGEPAGE_SIZE : Memory_GetPageSize();
+
+	return (size + granularity - 1) & ~(granularity - 1);
+}
+
+/**
+ * Maps a block of memory directly from the operating system. Blocks of at least
+ * MEMORY_HUGEPAGE_SIZE are aligned to a huge page boundary and marked for
+ * transparent huge pages, which cuts TLB misses on large tables.
+ *
+ * @param size Size in bytes of the block
+ * @returns pointer to zero-filled, page-aligned memory or NULL
+ */
+void* Memory_AllocatePages(uint64 size) {
+	uint8* result;
+#ifndef WINDOWS
+	uint8* mapping;
+	uint64 head;
+#endif
+
+	size = Memory_RoundPages(size);
+
+#ifdef WINDOWS
+	result = (uint8*)VirtualAlloc(NULL, (SIZE_T)size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	if (size < MEMORY_HUGEPAGE_SIZE) {
+		result = (uint8*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return result == MAP_FAILED ? NULL : result;
+	}
 
-	return true;
-}
\ No newline at end of file
+	mapping = (uint8*)mmap(NULL, size + MEMORY_HUGEPAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mapping == MAP_FAILED)
+		return NULL;
+
+	result = (uint8*)(((uint64)mapping + MEMORY_HUGEPAGE_SIZE - 1) & ~(uint64)(MEMORY_HUGEPAGE_SIZE - 1));
+	head = (uint64)(result - mapping);
+
+	if (head != 0)
+		munmap(mapping, head);
+	munmap(result + size, MEMORY_HUGEPAGE_SIZE - head);
+
+#ifdef MADV_HUGEPAGE
+	madvise(result, size, MADV_HUGEPAGE);
+#endif
+#endif
+
+	return result;
+}
+
+/**
+ * Resizes a block allocated by Memory_AllocatePages. On Linux the pages are
+ * remapped by the kernel, so growing a large block neither copies it nor needs
+ * the old and new blocks resident at once. Elsewhere the contents are copied.
+ *
+ * @param block Block to resize
+ * @param oldSize The size it was allocated with
+ * @param newSize The new size
+ * @returns pointer to the resized block, which may have moved, or NULL
+ */
+void* Memory_ReallocatePages(void* block, uint64 oldSize, uint64 newSize) {
+	uint8* result;
+
+	if (block == NULL)
+		return Memory_AllocatePages(newSize);
+
+	oldSize = Memory_RoundPages(oldSize);
+	newSize = Memory_RoundPages(newSize);
+
+	if (oldSize == newSize)
+		return block;
+
+#ifdef MREMAP_MAYMOVE
+	result = (uint8*)mremap(block, oldSize, newSize, MREMAP_MAYMOVE);
+	if (result == MAP_FAILED)
+		return NULL;
+
+#ifdef MADV_HUGEPAGE
+	if (newSize >= MEMORY_HUGEPAGE_SIZE)
+		madvise(result, newSize, MADV_HUGEPAGE);
+#endif
+#else
+	result = (uint8*)Memory_AllocatePages(newSize);
+	if (result == NULL)
+		return NULL;
+
+	Memory_BlockCopy((uint8*)block, result, oldSize < newSize ? oldSize : newSize);
+	Memory_FreePages(block, oldSize);
+#endif
+
+	return result;
+}
+
+/**
+ * Unmaps a block allocated by Memory_AllocatePages.
+ *
+ * @param block Block to free
+ * @param size The size it was allocated with
+ */
+void Memory_FreePages(void* block, uint64 size) {
+	if (block == NULL)
+		return;
+
+#ifdef WINDOWS
+	VirtualFree(block, 0, MEM_RELEASE);
+#else
+	munmap(block, Memory_RoundPages(size));
+#endif
+}
+
+
+/**
+ * Maps a whole file into memory.
+ *
+ * @param path Path of the file to map
+ * @param mode One of the MEMORY_MAP_* values
+ * @param block Receives the mapping, NULL for an empty file
+ * @param size Receives the size of the file, which is also the size of the mapping
+ * @returns true if the file was opened and mapped
+ */
+boolean Memory_MapFile(int8* path, uint8 mode, void** block, uint64* size) {
+	boolean result;
+#ifdef WINDOWS
+	HANDLE file;
+	HANDLE mapping;
+	LARGE_INTEGER fileSize;
+#else
+	int32 file;
+	struct stat status;
+#endif
+
+	assert(path != NULL && block != NULL && size != NULL);
+
+	*block = NULL;
+	*size = 0;
+
+#ifdef WINDOWS
+	file = CreateFileA(path, mode == MEMORY_MAP_READWRITE ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	result = GetFileSizeEx(file, &fileSize) != 0;
+
+	if (result && fileSize.QuadPart > 0) {
+		mapping = CreateFileMappingA(file, NULL, mode == MEMORY_MAP_READONLY ? PAGE_READONLY : (mode == MEMORY_MAP_COPYONWRITE ? PAGE_WRITECOPY : PAGE_READWRITE), 0, 0, NULL);
+		result = mapping != NULL;
+
+		if (result) {
+			*block = MapViewOfFile(mapping, mode == MEMORY_MAP_READONLY ? FILE_MAP_READ : (mode == MEMORY_MAP_COPYONWRITE ? FILE_MAP_COPY : FILE_MAP_WRITE), 0, 0, 0);
+			CloseHandle(mapping);
+
+			result = *block != NULL;
+			if (result)
+				*size = (uint64)fileSize.QuadPart;
+		}
+	}
+
+	CloseHandle(file);
+#else
+	file = open(path, mode == MEMORY_MAP_READWRITE ? O_RDWR : O_RDONLY);
+	if (file < 0)
+		return false;
+
+	result = fstat(file, &status) == 0;
+
+	if (result && status.st_size > 0) {
+		*block = mmap(NULL, (size_t)status.st_size, mode == MEMORY_MAP_READONLY ? PROT_READ : PROT_READ | PROT_WRITE, mode == MEMORY_MAP_READWRITE ? MAP_SHARED : MAP_PRIVATE, file, 0);
+
+		result = *block != MAP_FAILED;
+		if (result)
+			*size = (uint64)status.st_size;
+		else
+			*block = NULL;
+	}
+
+	close(file);
+#endif
+
+	return result;
+}
+
+/**
+ * Unmaps a file mapped by Memory_MapFile. Changes to a MEMORY_MAP_READWRITE
+ * mapping are written back by the operating system.
+ */
+void Memory_UnmapFile(void* block, uint64 size) {
+	if (block == NULL)
+		return;
+
+#ifdef WINDOWS
+	UnmapViewOfFile(block);
+#else
+	munmap(block, size);
+#endif
+}
+
+/**
+ * Writes changes to a MEMORY_MAP_READWRITE mapping back to its file and waits
+ * for the write to complete.
+ */
+void Memory_SyncFile(void* block, uint64 size) {
+	if (block == NULL)
+		return;
+
+#ifdef WINDOWS
+	FlushViewOfFile(block, (SIZE_T)size);
+#else
+	msync(block, size, MS_SYNC);
+#endif
+}
+
+/**
+ * Tells the operating system how a mapped range is about to be accessed so it
+ * can tune read-ahead. A no-op where unsupported.
+ *
+ * @param advice One of the MEMORY_ADVICE_* values
+ */
+void Memory_Advise(void* block, uint64 size, uint8 advice) {
+#ifndef WINDOWS
+	int32 flag;
+
+	if (block == NULL)
+		return;
+
+	switch (advice) {
+		case MEMORY_ADVICE_SEQUENTIAL: flag = MADV_SEQUENTIAL; break;
+		case MEMORY_ADVICE_RANDOM: flag = MADV_RANDOM; break;
+		case MEMORY_ADVICE_WILLNEED: flag = MADV_WILLNEED; break;
+		default: flag = MADV_NORMAL; break;
+	}
+
+	madvise(block, size, flag);
+#endif
+}
+
+
+
+#define POOL_CLASS_COUNT 12
+#define POOL_MAXIMUM_SIZE 1024
+#define POOL_SLAB_SIZE 65536
+#define POOL_CACHE_LIMIT 64
+#define POOL_BATCH 32
+
+typedef struct PoolObject PoolObject;
+
+struct PoolObject {
+	PoolObject* Next;
+};
+
+typedef struct {
+	PoolObject* Head;
+	uint32 Count;
+} PoolCache;
+
+typedef struct {
+	PoolObject* Head;
+	volatile int32 Lock;
+} PoolDepot;
+
+static const uint32 poolClassSizes[POOL_CLASS_COUNT] = { 16, 32, 48, 64, 96, 128, 192, 256, 384, 512, 768, 1024 };
+static PoolDepot poolDepots[POOL_CLASS_COUNT];
+static THREAD_LOCAL PoolCache poolCaches[POOL_CLASS_COUNT];
+
+static uint32 Memory_Pool_GetClass(uint64 size) {
+	uint32 i;
+
+	for (i = 0; poolClassSizes[i] < size; i++)
+		;
+
+	return i;
+}
+
+/* Moves up to POOL_BATCH objects from the shared depot into the thread's cache, carving a new slab if the depot is empty. */
+static void Memory_Pool_Refill(uint32 sizeClass) {
+	PoolDepot* depot;
+	PoolCache* cache;
+	PoolObject* object;
+	uint8* slab;
+	uint32 objectSize;
+	uint32 i;
+
+	depot = poolDepots + sizeClass;
+	cache = poolCaches + sizeClass;
+	objectSize = poolClassSizes[sizeClass];
+
+	SpinLock_Acquire(&depot->Lock);
+
+	if (depot->Head == NULL) {
+		slab = AllocateArray(uint8, POOL_SLAB_SIZE);
+
+		for (i = 0; i + objectSize <= POOL_SLAB_SIZE; i += objectSize) {
+			object = (PoolObject*)(slab + i);
+			object->Next = depot->Head;
+			depot->Head = object;
+		}
+	}
+
+	for (i = 0; i < POOL_BATCH && depot->Head != NULL; i++) {
+		object = depot->Head;
+		depot->Head = object->Next;
+		object->Next = cache->Head;
+		cache->Head = object;
+		cache->Count++;
+	}
+
+	SpinLock_Release(&depot->Lock);
+}
+
+/* Returns up to count objects from the thread's cache to the shared depot. */
+static void Memory_Pool_Drain(uint32 sizeClass, uint32 count) {
+	PoolDepot* depot;
+	PoolCache* cache;
+	PoolObject* first;
+	PoolObject* last;
+	uint32 i;
+
+	depot = poolDepots + sizeClass;
+	cache = poolCaches + sizeClass;
+
+	if (cache->Head == NULL || count == 0)
+		return;
+
+	first = cache->Head;
+	last = first;
+	for (i = 1; i < count && last->Next != NULL; i++)
+		last = last->Next;
+
+	cache->Head = last->Next;
+	cache->Count -= i;
+
+	SpinLock_Acquire(&depot->Lock);
+	last->Next = depot->Head;
+	depot->Head = first;
+	SpinLock_Release(&depot->Lock);
+}
+
+/**
+ * Allocates a small fixed-size block from the size-class pool. Each thread keeps
+ * its own free list per size class so the common path takes no lock. Requests
+ * larger than POOL_MAXIMUM_SIZE are passed through to the general allocator.
+ *
+ * @param size Size in bytes of the block
+ * @returns pointer to a block of at least @a size bytes
+ */
+void* Memory_Pool_Allocate(uint64 size) {
+	PoolCache* cache;
+	PoolObject* object;
+	uint32 sizeClass;
+
+	if (size > POOL_MAXIMUM_SIZE)
+		return AllocateArray(uint8, size);
+
+	sizeClass = Memory_Pool_GetClass(size);
+	cache = poolCaches + sizeClass;
+
+	if (cache->Head == NULL)
+		Memory_Pool_Refill(sizeClass);
+
+	object = cache->Head;
+	cache->Head = object->Next;
+	cache->Count--;
+
+	return object;
+}
+
+/**
+ * Returns a block to the calling thread's cache. The block may have been
+ * allocated on any thread.
+ *
+ * @param block Block returned by Memory_Pool_Allocate
+ * @param size The size that was passed to Memory_Pool_Allocate
+ */
+void Memory_Pool_Free(void* block, uint64 size) {
+	PoolCache* cache;
+	PoolObject* object;
+	uint32 sizeClass;
+
+	if (block == NULL)
+		return;
+
+	if (size > POOL_MAXIMUM_SIZE) {
+		Free(block);
+		return;
+	}
+
+	sizeClass = Memory_Pool_GetClass(size);
+	cache = poolCaches + sizeClass;
+	object = (PoolObject*)block;
+
+	object->Next = cache->Head;
+	cache->Head = object;
+	cache->Count++;
+
+	if (cache->Count > POOL_CACHE_LIMIT)
+		Memory_Pool_Drain(sizeClass, POOL_BATCH);
+}
+
+/**
+ * Returns every block cached by the calling thread to the shared pool. Threads
+ * that use the pool should call this before exiting.
+ */
+void Memory_Pool_FlushThreadCache(void) {
+	uint32 i;
+
+	for (i = 0; i < POOL_CLASS_COUNT; i++)
+		Memory_Pool_Drain(i, poolCaches[i].Count);
+}
+
+
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_MINIMUM_BLOCKSIZE 4096
+
+struct Memory_ArenaBlock {
+	Memory_ArenaBlock* Next;
+	uint64 Size;
+	uint64 Used;
+};
+
+#define ARENA_BLOCK_HEADER ((sizeof(Memory_ArenaBlock) + ARENA_ALIGNMENT - 1) & ~(uint64)(ARENA_ALIGNMENT - 1))
+#define ARENA_BLOCK_DATA(block) ((uint8*)(block) + ARENA_BLOCK_HEADER)
+
+static Memory_ArenaBlock* Memory_Arena_NewBlock(uint64 size) {
+	Memory_ArenaBlock* block;
+
+	block = (Memory_ArenaBlock*)AllocateArray(uint8, ARENA_BLOCK_HEADER + size);
+	block->Next = NULL;
+	block->Size = size;
+	block->Used = 0;
+
+	return block;
+}
+
+/**
+ * Create a new arena.
+ *
+ * @param blockSize Size in bytes of each block the arena carves allocations from
+ * @returns pointer to newly initialized arena
+ */
+Memory_Arena* Memory_Arena_New(uint64 blockSize) {
+	Memory_Arena* arena;
+
+	arena = Allocate(Memory_Arena);
+	Memory_Arena_Initialize(arena, blockSize);
+
+	return arena;
+}
+
+/**
+ * Initialize an already allocated arena. No memory is reserved until the first
+ * allocation.
+ *
+ * @param arena Arena to initialize
+ * @param blockSize Size in bytes of each block the arena carves allocations from
+ */
+void Memory_Arena_Initialize(Memory_Arena* arena, uint64 blockSize) {
+	assert(arena != NULL);
+
+	arena->First = NULL;
+	arena->Current = NULL;
+	arena->BlockSize = blockSize < ARENA_MINIMUM_BLOCKSIZE ? ARENA_MINIMUM_BLOCKSIZE : blockSize;
+}
+
+void Memory_Arena_Free(Memory_Arena* self) {
+	Memory_Arena_Uninitialize(self);
+	Free(self);
+}
+
+/**
+ * Releases every block owned by the arena. All pointers handed out by the arena
+ * become invalid.
+ */
+void Memory_Arena_Uninitialize(Memory_Arena* self) {
+	Memory_ArenaBlock* block;
+
+	assert(self != NULL);
+
+	while (self->First != NULL) {
+		block = self->First;
+		self->First = block->Next;
+		Free(block);
+	}
+
+	self->Current = NULL;
+}
+
+/**
+ * @returns a pointer to @a size bytes aligned to ARENA_ALIGNMENT. Blocks left
+ * behind by an earlier reset or rewind are reused before new ones are allocated.
+ */
+void* Memory_Arena_Allocate(Memory_Arena* self, uint64 size) {
+	Memory_ArenaBlock* block;
+	Memory_ArenaBlock* next;
+	uint8* result;
+
+	assert(self != NULL);
+
+	size = (size + ARENA_ALIGNMENT - 1) & ~(uint64)(ARENA_ALIGNMENT - 1);
+	block = self->Current;
+
+	if (block == NULL || block->Size - block->Used < size) {
+		next = block ? block->Next : self->First;
+
+		if (next != NULL && next->Size >= size) {
+			block = next;
+			block->Used = 0;
+		}
+		else {
+			next = Memory_Arena_NewBlock(size > self->BlockSize ? size : self->BlockSize);
+
+			if (block == NULL) {
+				next->Next = self->First;
+				self->First = next;
+			}
+			else {
+				next->Next = block->Next;
+				block->Next = next;
+			}
+
+			block = next;
+		}
+
+		self->Current = block;
+	}
+
+	result = ARENA_BLOCK_DATA(block) + block->Used;
+	block->Used += size;
+
+	return result;
+}
+
+/**
+ * Resize an allocation made from @a self. If @a block was the most recent
+ * allocation and there is room, it is grown in place; otherwise a new region is
+ * allocated and the first @a oldSize bytes are copied into it.
+ */
+void* Memory_Arena_Reallocate(Memory_Arena* self, void* block, uint64 oldSize, uint64 newSize) {
+	Memory_ArenaBlock* current;
+	uint8* result;
+
+	assert(self != NULL);
+
+	if (block == NULL)
+		return Memory_Arena_Allocate(self, newSize);
+
+	current = self->Current;
+	oldSize = (oldSize + ARENA_ALIGNMENT - 1) & ~(uint64)(ARENA_ALIGNMENT - 1);
+	newSize = (newSize + ARENA_ALIGNMENT - 1) & ~(uint64)(ARENA_ALIGNMENT - 1);
+
+	if (current != NULL && (uint8*)block + oldSize == ARENA_BLOCK_DATA(current) + current->Used && (uint8*)block - ARENA_BLOCK_DATA(current) + newSize <= current->Size) {
+		current->Used = (uint8*)block - ARENA_BLOCK_DATA(current) + newSize;
+		return block;
+	}
+
+	if (newSize <= oldSize)
+		return block;
+
+	result = (uint8*)Memory_Arena_Allocate(self, newSize);
+	Memory_BlockCopy((uint8*)block, result, oldSize);
+
+	return result;
+}
+
+/**
+ * @returns the current top of the arena, to be passed to Memory_Arena_Rewind.
+ */
+Memory_ArenaMark Memory_Arena_Mark(Memory_Arena* self) {
+	Memory_ArenaMark mark;
+
+	assert(self != NULL);
+
+	mark.Block = self->Current;
+	mark.Used = self->Current ? self->Current->Used : 0;
+
+	return mark;
+}
+
+/**
+ * Releases everything allocated since @a mark was taken. The blocks are kept for
+ * reuse.
+ */
+void Memory_Arena_Rewind(Memory_Arena* self, Memory_ArenaMark mark) {
+	assert(self != NULL);
+
+	if (mark.Block == NULL) {
+		Memory_Arena_Reset(self);
+		return;
+	}
+
+	self->Current = mark.Block;
+	self->Current->Used = mark.Used;
+}
+
+/**
+ * Releases every allocation made from the arena while keeping its blocks for reuse.
+ */
+void Memory_Arena_Reset(Memory_Arena* self) {
+	assert(self != NULL);
+
+	self->Current = NULL;
+}
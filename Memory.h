@@ -5,7 +5,54 @@
 
 export void Memory_Free(void* block);
 export void Memory_BlockCopy(uint8* source, uint8* destination, uint64 amount);
+export void Memory_Move(uint8* source, uint8* destination, uint64 amount);
 export boolean Memory_Compare(uint8* blockA, uint8* blockB, uint64 lengthA, uint64 lengthB);
+export int32 Memory_CompareOrder(uint8* blockA, uint8* blockB, uint64 lengthA, uint64 lengthB);
+export uint8* Memory_FindByte(uint8* block, uint64 length, uint8 value);
+export uint8* Memory_FindBytes(uint8* block, uint64 length, uint8* needle, uint64 needleLength);
+
+#define MEMORY_CPU_SSE2 0x1
+#define MEMORY_CPU_SSE41 0x2
+#define MEMORY_CPU_AVX2 0x4
+#define MEMORY_CPU_AVX512 0x8
+
+export uint32 Memory_GetCPUFeatures(void);
+
+#define MEMORY_CACHELINE 64
+#define MEMORY_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+export void* Memory_AllocateAligned(uint64 size, uint64 alignment);
+export void Memory_FreeAligned(void* block);
+export void* Memory_AllocatePages(uint64 size);
+export void* Memory_ReallocatePages(void* block, uint64 oldSize, uint64 newSize);
+export void Memory_FreePages(void* block, uint64 size);
+
+#define MEMORY_MAP_READONLY 0
+#define MEMORY_MAP_COPYONWRITE 1 /* writable, but changes stay private to the process */
+#define MEMORY_MAP_READWRITE 2 /* writable, and changes are written back to the file */
+
+#define MEMORY_ADVICE_NORMAL 0
+#define MEMORY_ADVICE_SEQUENTIAL 1
+#define MEMORY_ADVICE_RANDOM 2
+#define MEMORY_ADVICE_WILLNEED 3
+
+export boolean Memory_MapFile(int8* path, uint8 mode, void** block, uint64* size);
+export void Memory_UnmapFile(void* block, uint64 size);
+export void Memory_SyncFile(void* block, uint64 size);
+export void Memory_Advise(void* block, uint64 size, uint8 advice);
+
+/**
+ * @returns a pointer to a block of memory large enough to contain @a count
+ * objects of size @a type, aligned to @a alignment bytes. Must be released with
+ * FreeAligned.
+ */
+#define AllocateArrayAligned(type, count, alignment) ((type*)Memory_AllocateAligned(sizeof(type) * (count), (alignment)))
+
+/**
+ * Frees a block of memory allocated by AllocateArrayAligned
+ * @param pointer The block of memory to free
+ */
+#define FreeAligned(pointer) Memory_FreeAligned(pointer)
 
 /**
  * Frees a block of memory allocated by Allocate or AllocateArray
@@ -44,7 +91,97 @@ export void* Memory_ReallocateD(void* block, uint64 size, uint64 line, int8* fil
 #define AllocateArray(type, count) ((type*)Memory_AllocateD(sizeof(type) * count, __LINE__, __FILE__))
 #define ReallocateArray(type, count, array) ((type*)Memory_ReallocateD((void*)array, sizeof(type) * count, __LINE__, __FILE__))
 
+/**
+ * Allocation counters for one Allocate/AllocateArray/ReallocateArray callsite.
+ * Count and Bytes are cumulative; LiveCount and LiveBytes drop as blocks are freed.
+ */
+typedef struct {
+	int8* File;
+	uint64 Line;
+	uint64 Count;
+	uint64 Bytes;
+	uint64 LiveCount;
+	uint64 LiveBytes;
+	uint64 PeakBytes;
+} Memory_CallSite;
+
+typedef struct {
+	Memory_CallSite* Sites;
+	uint32 Count;
+} Memory_Snapshot;
+
+export Memory_Snapshot* Memory_Profiler_TakeSnapshot(void);
+export Memory_Snapshot* Memory_Profiler_Diff(Memory_Snapshot* before, Memory_Snapshot* after);
+export void Memory_Profiler_FreeSnapshot(Memory_Snapshot* snapshot);
+export void Memory_Profiler_Report(Memory_Snapshot* snapshot);
+export void Memory_Profiler_ReportLeaks(void);
+
 #endif
 
+export void* Memory_Pool_Allocate(uint64 size);
+export void Memory_Pool_Free(void* block, uint64 size);
+export void Memory_Pool_FlushThreadCache(void);
+
+/**
+ * @returns a pointer to a block of memory at least the sizeof @a type taken from
+ * the size-class pool. Must be released with PoolFree using the same @a type.
+ */
+#define PoolAllocate(type) ((type*)Memory_Pool_Allocate(sizeof(type)))
+
+/**
+ * Returns a block allocated by PoolAllocate to the calling thread's cache.
+ * @param pointer The block of memory to free
+ * @param type The type it was allocated as
+ */
+#define PoolFree(pointer, type) Memory_Pool_Free((pointer), sizeof(type))
+
+/* forward declarations */
+typedef struct Memory_ArenaBlock Memory_ArenaBlock;
+
+/**
+ * A region allocator. Allocations are carved out of large blocks and are never
+ * freed individually; the whole arena is released with one call to
+ * Memory_Arena_Reset or rolled back to an earlier Memory_Arena_Mark.
+ */
+typedef struct {
+	Memory_ArenaBlock* First;
+	Memory_ArenaBlock* Current;
+	uint64 BlockSize;
+} Memory_Arena;
+
+typedef struct {
+	Memory_ArenaBlock* Block;
+	uint64 Used;
+} Memory_ArenaMark;
+
+export Memory_Arena* Memory_Arena_New(uint64 blockSize);
+export void Memory_Arena_Initialize(Memory_Arena* arena, uint64 blockSize);
+export void Memory_Arena_Free(Memory_Arena* self);
+export void Memory_Arena_Uninitialize(Memory_Arena* self);
+
+export void* Memory_Arena_Allocate(Memory_Arena* self, uint64 size);
+export void* Memory_Arena_Reallocate(Memory_Arena* self, void* block, uint64 oldSize, uint64 newSize);
+export Memory_ArenaMark Memory_Arena_Mark(Memory_Arena* self);
+export void Memory_Arena_Rewind(Memory_Arena* self, Memory_ArenaMark mark);
+export void Memory_Arena_Reset(Memory_Arena* self);
+
+/**
+ * @returns a pointer to a block of memory from @a arena at least the sizeof @a type.
+ * The memory is released when the arena is reset, never by Free.
+ */
+#define ArenaAllocate(arena, type) ((type*)Memory_Arena_Allocate((arena), sizeof(type)))
+
+/**
+ * @returns a pointer to a block of memory from @a arena large enough to contain
+ * @a count objects of size @a type.
+ */
+#define ArenaAllocateArray(arena, type, count) ((type*)Memory_Arena_Allocate((arena), sizeof(type) * (count)))
+
+/**
+ * @returns a pointer to a block of memory from @a arena large enough to contain
+ * @a count objects of size @a type, holding the first @a oldCount objects of @a array.
+ * Grows in place when @a array is the most recent allocation in the arena.
+ */
+#define ArenaReallocateArray(arena, type, oldCount, count, array) ((type*)Memory_Arena_Reallocate((arena), (void*)(array), sizeof(type) * (oldCount), sizeof(type) * (count)))
 
 #endif
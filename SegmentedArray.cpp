@@ -0,0 +1,242 @@
+/** vim: set noet ci pi sts=0 sw=4 ts=4
+ * @file SegmentedArray.c
+ * @brief An append-only buffer made of fixed-size chunks that never
+ * reallocates, with a read cursor that releases chunks as they are consumed.
+ */
+#include "SegmentedArray.h"
+
+#define MINIMUM_CHUNKSIZE 256
+
+struct SegmentedArray_Chunk {
+	SegmentedArray_Chunk* Next;
+	uint64 Used;
+};
+
+#define CHUNK_DATA(chunk) ((uint8*)((chunk) + 1))
+
+/**
+ * Create a new segmented array.
+ *
+ * @param chunkSize Size in bytes of each chunk
+ * @returns pointer to newly initialized array
+ */
+SegmentedArray* SegmentedArray_New(uint64 chunkSize) {
+	SegmentedArray* array;
+
+	array = Allocate(SegmentedArray);
+	SegmentedArray_Initialize(array, chunkSize);
+
+	return array;
+}
+
+/**
+ * Initialize an already allocated segmented array. No chunk is allocated until
+ * the first append.
+ *
+ * @param array array object to initialize
+ * @param chunkSize Size in bytes of each chunk
+ */
+void SegmentedArray_Initialize(SegmentedArray* array, uint64 chunkSize) {
+	assert(array != NULL);
+
+	array->First = NULL;
+	array->Last = NULL;
+	array->ChunkSize = chunkSize < MINIMUM_CHUNKSIZE ? MINIMUM_CHUNKSIZE : chunkSize;
+	array->Size = 0;
+	array->ReadOffset = 0;
+}
+
+void SegmentedArray_Free(SegmentedArray* self) {
+	SegmentedArray_Uninitialize(self);
+	Free(self);
+}
+
+void SegmentedArray_Uninitialize(SegmentedArray* self) {
+	SegmentedArray_Chunk* chunk;
+
+	assert(self != NULL);
+
+	while (self->First != NULL) {
+		chunk = self->First;
+		self->First = chunk->Next;
+		Free(chunk);
+	}
+
+	self->Last = NULL;
+	self->Size = 0;
+	self->ReadOffset = 0;
+}
+
+/**
+ * Append bytes, filling the last chunk and then adding new ones. Existing data
+ * is never moved.
+ *
+ * @param self Array to append to
+ * @param data Data to append
+ * @param amount Number of bytes to append from @a data
+ */
+void SegmentedArray_Append(SegmentedArray* self, uint8* data, uint64 amount) {
+	SegmentedArray_Chunk* chunk;
+	uint64 available;
+
+	assert(self != NULL);
+	assert(data != NULL || amount == 0);
+
+	self->Size += amount;
+
+	while (amount > 0) {
+		chunk = self->Last;
+
+		if (chunk == NULL || chunk->Used == self->ChunkSize) {
+			chunk = (SegmentedArray_Chunk*)AllocateArray(uint8, sizeof(SegmentedArray_Chunk) + self->ChunkSize);
+			chunk->Next = NULL;
+			chunk->Used = 0;
+
+			if (self->Last != NULL)
+				self->Last->Next = chunk;
+			else
+				self->First = chunk;
+
+			self->Last = chunk;
+		}
+
+		available = self->ChunkSize - chunk->Used;
+		if (available > amount)
+			available = amount;
+
+		Memory_BlockCopy(data, CHUNK_DATA(chunk) + chunk->Used, available);
+		chunk->Used += available;
+		data += available;
+		amount -= available;
+	}
+}
+
+void SegmentedArray_AppendView(SegmentedArray* self, ArrayView view) {
+	SegmentedArray_Append(self, view.Data, view.Size);
+}
+
+/**
+ * Copy bytes from the read cursor into a user supplied buffer and consume them.
+ *
+ * @param self Array to read from
+ * @param targetBuffer Buffer to write to
+ * @param amount Maximum number of bytes to read
+ * @returns the number of bytes read
+ */
+uint64 SegmentedArray_Read(SegmentedArray* self, uint8* targetBuffer, uint64 amount) {
+	SegmentedArray_Chunk* chunk;
+	uint64 offset;
+	uint64 available;
+	uint64 read;
+
+	assert(self != NULL && targetBuffer != NULL);
+
+	if (amount > self->Size)
+		amount = self->Size;
+
+	chunk = self->First;
+	offset = self->ReadOffset;
+
+	for (read = 0; read < amount; chunk = chunk->Next, offset = 0) {
+		available = chunk->Used - offset;
+		if (available > amount - read)
+			available = amount - read;
+
+		Memory_BlockCopy(CHUNK_DATA(chunk) + offset, targetBuffer + read, available);
+		read += available;
+	}
+
+	SegmentedArray_Consume(self, read);
+
+	return read;
+}
+
+/**
+ * Advance the read cursor, releasing chunks that have been fully consumed. Use
+ * after writev has sent part of the vectors from SegmentedArray_GetIOVectors.
+ *
+ * @param self Array to consume from
+ * @param amount Number of bytes to skip
+ */
+void SegmentedArray_Consume(SegmentedArray* self, uint64 amount) {
+	SegmentedArray_Chunk* chunk;
+	uint64 available;
+
+	assert(self != NULL);
+	assert(amount <= self->Size);
+
+	self->Size -= amount;
+
+	while (self->First != NULL) {
+		chunk = self->First;
+		available = chunk->Used - self->ReadOffset;
+
+		if (amount < available || (amount == available && chunk == self->Last && chunk->Used != self->ChunkSize)) {
+			self->ReadOffset += amount;
+			return;
+		}
+
+		amount -= available;
+		self->First = chunk->Next;
+		self->ReadOffset = 0;
+		Free(chunk);
+	}
+
+	self->Last = NULL;
+}
+
+/**
+ * Describe the unread bytes as a list of buffers without copying them.
+ *
+ * @param self Array to export
+ * @param vectors Array of at least @a maxVectors entries to fill
+ * @param maxVectors Capacity of @a vectors
+ * @returns the number of entries filled
+ */
+uint32 SegmentedArray_GetIOVectors(SegmentedArray* self, SegmentedArray_IOVector* vectors, uint32 maxVectors) {
+	SegmentedArray_Chunk* chunk;
+	uint64 offset;
+	uint32 count;
+
+	assert(self != NULL && vectors != NULL);
+
+	count = 0;
+	offset = self->ReadOffset;
+
+	for (chunk = self->First; chunk != NULL && count < maxVectors; chunk = chunk->Next, offset = 0) {
+		if (chunk->Used == offset)
+			continue;
+
+		vectors[count].Base = CHUNK_DATA(chunk) + offset;
+		vectors[count].Length = chunk->Used - offset;
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Copy the unread bytes into one contiguous array. The segmented array is left
+ * unchanged.
+ *
+ * @returns pointer to newly created array
+ */
+Array* SegmentedArray_Flatten(SegmentedArray* self) {
+	SegmentedArray_Chunk* chunk;
+	Array* array;
+	uint64 offset;
+	uint64 position;
+
+	assert(self != NULL);
+
+	array = Array_New(self->Size);
+	position = 0;
+	offset = self->ReadOffset;
+
+	for (chunk = self->First; chunk != NULL; chunk = chunk->Next, offset = 0) {
+		Memory_BlockCopy(CHUNK_DATA(chunk) + offset, array->Data + position, chunk->Used - offset);
+		position += chunk->Used - offset;
+	}
+
+	return array;
+}
@@ -0,0 +1,37 @@
+#ifndef INCLUDE_UTILITIES_SEGMENTEDARRAY
+#define INCLUDE_UTILITIES_SEGMENTEDARRAY
+
+#include "Common.h"
+#include "Array.h"
+
+/* forward declarations */
+typedef struct SegmentedArray_Chunk SegmentedArray_Chunk;
+
+/* Laid out like struct iovec on 64-bit POSIX so an array of these can be handed straight to writev. */
+typedef struct {
+	void* Base;
+	uint64 Length;
+} SegmentedArray_IOVector;
+
+/* An append-only byte buffer made of fixed-size chunks. Appending never moves existing data, so building a payload of n bytes copies each byte once. */
+typedef struct {
+	SegmentedArray_Chunk* First;
+	SegmentedArray_Chunk* Last;
+	uint64 ChunkSize;
+	uint64 Size; /* bytes appended and not yet consumed */
+	uint64 ReadOffset; /* offset of the read cursor within First */
+} SegmentedArray;
+
+export SegmentedArray* SegmentedArray_New(uint64 chunkSize);
+export void SegmentedArray_Initialize(SegmentedArray* array, uint64 chunkSize);
+export void SegmentedArray_Free(SegmentedArray* self);
+export void SegmentedArray_Uninitialize(SegmentedArray* self);
+
+export void SegmentedArray_Append(SegmentedArray* self, uint8* data, uint64 amount);
+export void SegmentedArray_AppendView(SegmentedArray* self, ArrayView view);
+export uint64 SegmentedArray_Read(SegmentedArray* self, uint8* targetBuffer, uint64 amount);
+export void SegmentedArray_Consume(SegmentedArray* self, uint64 amount);
+export uint32 SegmentedArray_GetIOVectors(SegmentedArray* self, SegmentedArray_IOVector* vectors, uint32 maxVectors);
+export Array* SegmentedArray_Flatten(SegmentedArray* self);
+
+#endif
@@ -10,9 +10,9 @@ Stack* Stack_New(uint64 size) {
 	return stack;
 }
 
+/* size is the initial allocation in bytes, as for Array_Initialize */
 void Stack_Initialize(Stack* stack, uint64 size) {
-	stack->Pointer = 0;
-	Array_Initialize(&stack->Data, size);
+	PointerVector_Initialize(&stack->Data, size / sizeof(void*));
 }
 
 void Stack_Free(Stack* self) {
@@ -21,17 +21,13 @@ void Stack_Free(Stack* self) {
 }
 
 void Stack_Uninitialize(Stack* self) {
-	Array_Free(&self->Data);
-	self->Pointer = 0;
+	PointerVector_Uninitialize(&self->Data);
 }
 
 void Stack_Push(Stack* self, void* value) {
-	Array_Write(&self->Data, (uint8*)&value, self->Pointer, sizeof(void*));
-	self->Pointer += sizeof(void*);
+	PointerVector_Push(&self->Data, value);
 }
 
 void* Stack_Pop(Stack* self) {
-	assert(self->Pointer >= sizeof(void*));
-	self->Pointer -= sizeof(void*);
-	return (void*)Array_Read(&self->Data, self->Pointer, sizeof(void*));
+	return PointerVector_Pop(&self->Data);
 }
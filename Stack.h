@@ -2,11 +2,10 @@
 #define INCLUDE_UTILITIES_STACK
 
 #include "Common.h"
-#include "Array.h"
+#include "Vector.h"
 
 typedef struct {
-	Array Data;
-	uint64 Pointer;
+	PointerVector Data;
 } Stack;
 
 export Stack* Stack_New(uint64 size);
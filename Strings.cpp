@@ -1,34 +1,41 @@
 #include "Strings.h"
+#include "Intrinsics.h"
+#include "FloatTables.h"
 
+#include <stdlib.h>
 #include <string.h>
 
-String* String_New(uint16 size) {
+String* String_New(uint64 capacity) {
 	String* string;
 
 	string = Allocate(String);
-	String_Initialize(string, size);
+	String_Initialize(string, capacity);
 
 	return string;
 }
 
 String* String_NewFromCString(int8* cString) {
 	String* string;
-	uint16 size;
 
-	size = (uint16)strlen(cString);
-
-	string = Allocate(String);
-	String_Initialize(string, size);
-
-	string->Length = 0;
+	string = String_New(strlen(cString));
 	String_AppendCString(string, cString);
 
 	return string;
 }
 
-void String_Initialize(String* string, uint16 size) {
-	string->Length = size;
-	Array_Initialize(&string->Data, size);
+/**
+ * Prepares an empty string with room for @a capacity bytes. Capacities of
+ * STRING_INLINE_CAPACITY or less need no heap allocation.
+ */
+void String_Initialize(String* string, uint64 capacity) {
+	assert(string != NULL);
+
+	string->Length = 0;
+	string->Hash = 0;
+	string->Storage.Inline.IsHeap = false;
+	string->Storage.Inline.Data[0] = '\0';
+
+	String_Reserve(string, capacity);
 }
 
 void String_Free(String* self) {
@@ -39,67 +46,2023 @@ void String_Free(String* self) {
 void String_Uninitialize(String* self) {
 	assert(self != NULL);
 
-	Array_Free(&self->Data);
+	if (self->Storage.Inline.IsHeap)
+		Free(self->Storage.Heap.Data);
+
 	self->Length = 0;
+	self->Hash = 0;
+	self->Storage.Inline.IsHeap = false;
+	self->Storage.Inline.Data[0] = '\0';
 }
 
-void String_AppendCString(String* self, int8* cString) {
-	uint16 size;
+/**
+ * Ensures the string can grow to @a capacity bytes without reallocating.
+ * Growth at least doubles the allocation so repeated appends stay amortized
+ * O(1).
+ */
+void String_Reserve(String* self, uint64 capacity) {
+	uint64 allocation;
+	uint8* data;
 
 	assert(self != NULL);
-	assert(cString != NULL);
 
-	size = (uint16)strlen(cString);
+	if (!self->Storage.Inline.IsHeap) {
+		if (capacity <= STRING_INLINE_CAPACITY)
+			return;
 
-	Array_Write(&self->Data, (uint8*)cString, self->Length, size);
-	self->Length += size;
+		allocation = capacity + 1;
+		if (allocation < (STRING_INLINE_CAPACITY + 1) * 2)
+			allocation = (STRING_INLINE_CAPACITY + 1) * 2;
+
+		data = AllocateArray(uint8, allocation);
+		memcpy(data, self->Storage.Inline.Data, (size_t)self->Length + 1);
+
+		self->Storage.Heap.Data = data;
+		self->Storage.Heap.Allocation = allocation;
+		self->Storage.Heap.IsHeap = true;
+	}
+	else if (capacity + 1 > self->Storage.Heap.Allocation) {
+		allocation = self->Storage.Heap.Allocation * 2;
+		if (allocation < capacity + 1)
+			allocation = capacity + 1;
+
+		self->Storage.Heap.Data = ReallocateArray(uint8, allocation, self->Storage.Heap.Data);
+		self->Storage.Heap.Allocation = allocation;
+	}
+}
+
+/* Empties the string but keeps its allocation. */
+void String_Clear(String* self) {
+	assert(self != NULL);
+
+	self->Length = 0;
+	self->Hash = 0;
+	String_GetData(self)[0] = '\0';
+}
+
+void String_AppendCString(String* self, int8* cString) {
+	assert(cString != NULL);
+
+	String_AppendBytes(self, cString, strlen(cString));
 }
 
-void String_AppendBytes(String* self, int8* bytes, uint16 size) {
+void String_AppendBytes(String* self, int8* bytes, uint64 size) {
+	uint8* data;
+
 	assert(self != NULL);
-	assert(bytes != NULL);
+	assert(bytes != NULL || size == 0);
+
+	String_Reserve(self, self->Length + size);
 
-	Array_Write(&self->Data, (uint8*)bytes, self->Length, size);
+	data = String_GetData(self);
+	memcpy(data + self->Length, bytes, (size_t)size);
 	self->Length += size;
+	self->Hash = 0;
+	data[self->Length] = '\0';
 }
 
 void String_AppendString(String* self, String* source) {
 	assert(self != NULL && source != NULL);
 
-	Array_Append(&self->Data, &source->Data);
-	self->Length += source->Length;
+	/* reserve first so that appending a string to itself does not read from a freed allocation */
+	String_Reserve(self, self->Length + source->Length);
+	String_AppendBytes(self, (int8*)String_GetData(source), source->Length);
+}
+
+void String_AppendView(String* self, ArrayView view) {
+	String_AppendBytes(self, (int8*)view.Data, view.Size);
+}
+
+ArrayView String_View(String* self) {
+	assert(self != NULL);
+
+	return ArrayView_FromBytes(String_GetData(self), self->Length);
+}
+
+/**
+ * Hashes bytes eight at a time and finishes with the MurmurHash3 finalizer,
+ * so nearby keys land far apart. This is the hash String_Hash caches and
+ * HashTable buckets by.
+ */
+uint64 String_HashBytes(uint8* bytes, uint64 length) {
+	uint64 hash;
+	uint64 word;
+	uint64 i;
+
+	hash = 0x9E3779B97F4A7C15ULL ^ (length * 0xC2B2AE3D27D4EB4FULL);
+
+	for (i = 0; i + 8 <= length; i += 8) {
+		memcpy(&word, bytes + i, 8);
+		hash ^= word * 0x87C37B91114253D5ULL;
+		hash = ((hash << 31) | (hash >> 33)) * 0x4CF5AD432745937FULL;
+	}
+
+	if (i < length) {
+		word = 0;
+		memcpy(&word, bytes + i, (size_t)(length - i));
+		hash ^= word * 0x87C37B91114253D5ULL;
+		hash = ((hash << 31) | (hash >> 33)) * 0x4CF5AD432745937FULL;
+	}
+
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDULL;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ULL;
+	hash ^= hash >> 33;
+
+	return hash;
+}
+
+/**
+ * Returns the hash of the string's bytes. It is computed on first use and
+ * kept until the string is next modified, so code that writes through
+ * String_GetData directly must reset Hash to 0.
+ */
+uint64 String_Hash(String* self) {
+	assert(self != NULL);
+
+	if (self->Hash == 0)
+		self->Hash = String_HashBytes(String_GetData(self), self->Length);
+
+	return self->Hash;
+}
+
+/**
+ * Compares two strings byte for byte, after rejecting on length and, when
+ * both are already known, on the cached hashes.
+ */
+boolean String_Equals(String* a, String* b) {
+	assert(a != NULL && b != NULL);
+
+	if (a == b)
+		return true;
+
+	if (a->Length != b->Length || (a->Hash != 0 && b->Hash != 0 && a->Hash != b->Hash))
+		return false;
+
+	return Memory_Compare(String_GetData(a), String_GetData(b), a->Length, b->Length);
+}
+
+#ifdef INTRINSICS_X86
+
+#define UTF8_TOO_SHORT 0x01 /* lead byte or ASCII followed by a lead byte or ASCII where a continuation was needed */
+#define UTF8_TOO_LONG 0x02 /* ASCII followed by a continuation */
+#define UTF8_OVERLONG_3 0x04
+#define UTF8_TOO_LARGE 0x08 /* above U+10FFFF */
+#define UTF8_SURROGATE 0x10
+#define UTF8_OVERLONG_2 0x20
+#define UTF8_TOO_LARGE_1000 0x40
+#define UTF8_OVERLONG_4 0x40
+#define UTF8_TWO_CONTINUATIONS 0x80
+#define UTF8_CARRY (UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTINUATIONS)
+
+/* Each table maps a nibble to the set of errors it could take part in; an error exists where all three lookups agree. See Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte". */
+#define UTF8_BYTE_1_HIGH \
+	UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, \
+	UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, UTF8_TWO_CONTINUATIONS, \
+	UTF8_TOO_SHORT | UTF8_OVERLONG_2, \
+	UTF8_TOO_SHORT, \
+	UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE, \
+	(int8)(UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4)
+
+#define UTF8_BYTE_1_LOW \
+	(int8)(UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4), \
+	(int8)(UTF8_CARRY | UTF8_OVERLONG_2), \
+	(int8)UTF8_CARRY, \
+	(int8)UTF8_CARRY, \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE), \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE), \
+	(int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000), (int8)(UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000)
+
+#define UTF8_BYTE_2_HIGH \
+	UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, \
+	(int8)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4), \
+	(int8)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE), \
+	(int8)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE), (int8)(UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTINUATIONS | UTF8_SURROGATE | UTF8_TOO_LARGE), \
+	UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+/* a block ending in one of these bytes at these positions leaves a sequence unfinished */
+#define UTF8_INCOMPLETE_16 -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, (int8)(0xF0 - 1), (int8)(0xE0 - 1), (int8)(0xC0 - 1)
+
+/*
+ * Validates whole 16 byte blocks starting at a sequence boundary. A sequence
+ * left unfinished by the last block is not an error here; the caller finishes
+ * it with the scalar validator.
+ */
+static boolean TARGET("sse4.1") String_ValidateUTF8SSE41(uint8* bytes, uint64 length) {
+	__m128i byte1High, byte1Low, byte2High, incompleteLimit, nibble;
+	__m128i input, previous, previousIncomplete, error;
+	__m128i previous1, previous2, previous3, special, must23;
+	uint64 i;
+
+	byte1High = _mm_setr_epi8(UTF8_BYTE_1_HIGH);
+	byte1Low = _mm_setr_epi8(UTF8_BYTE_1_LOW);
+	byte2High = _mm_setr_epi8(UTF8_BYTE_2_HIGH);
+	incompleteLimit = _mm_setr_epi8(UTF8_INCOMPLETE_16);
+	nibble = _mm_set1_epi8(0x0F);
+
+	previous = _mm_setzero_si128();
+	previousIncomplete = _mm_setzero_si128();
+	error = _mm_setzero_si128();
+
+	for (i = 0; i < length; i += 16) {
+		input = _mm_loadu_si128((__m128i*)(bytes + i));
+
+		if (_mm_movemask_epi8(input) == 0) {
+			error = _mm_or_si128(error, previousIncomplete);
+		}
+		else {
+			previous1 = _mm_alignr_epi8(input, previous, 15);
+			previous2 = _mm_alignr_epi8(input, previous, 14);
+			previous3 = _mm_alignr_epi8(input, previous, 13);
+
+			special = _mm_and_si128(_mm_and_si128(
+				_mm_shuffle_epi8(byte1High, _mm_and_si128(_mm_srli_epi16(previous1, 4), nibble)),
+				_mm_shuffle_epi8(byte1Low, _mm_and_si128(previous1, nibble))),
+				_mm_shuffle_epi8(byte2High, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+
+			must23 = _mm_or_si128(_mm_subs_epu8(previous2, _mm_set1_epi8(0xE0 - 0x80)), _mm_subs_epu8(previous3, _mm_set1_epi8((int8)(0xF0 - 0x80))));
+			must23 = _mm_and_si128(must23, _mm_set1_epi8((int8)0x80));
+
+			error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+		}
+
+		previousIncomplete = _mm_subs_epu8(input, incompleteLimit);
+		previous = input;
+	}
+
+	return _mm_testz_si128(error, error);
+}
+
+static boolean TARGET("avx2") String_ValidateUTF8AVX2(uint8* bytes, uint64 length) {
+	__m256i byte1High, byte1Low, byte2High, incompleteLimit, nibble;
+	__m256i input, previous, previousIncomplete, error, shifted;
+	__m256i previous1, previous2, previous3, special, must23;
+	uint64 i;
+
+	byte1High = _mm256_setr_epi8(UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH);
+	byte1Low = _mm256_setr_epi8(UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW);
+	byte2High = _mm256_setr_epi8(UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH);
+	incompleteLimit = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, UTF8_INCOMPLETE_16);
+	nibble = _mm256_set1_epi8(0x0F);
+
+	previous = _mm256_setzero_si256();
+	previousIncomplete = _mm256_setzero_si256();
+	error = _mm256_setzero_si256();
+
+	for (i = 0; i < length; i += 32) {
+		input = _mm256_loadu_si256((__m256i*)(bytes + i));
+
+		if (_mm256_movemask_epi8(input) == 0) {
+			error = _mm256_or_si256(error, previousIncomplete);
+		}
+		else {
+			/* the upper half of previous followed by the lower half of input, so alignr can reach across the lane boundary */
+			shifted = _mm256_permute2x128_si256(previous, input, 0x21);
+			previous1 = _mm256_alignr_epi8(input, shifted, 15);
+			previous2 = _mm256_alignr_epi8(input, shifted, 14);
+			previous3 = _mm256_alignr_epi8(input, shifted, 13);
+
+			special = _mm256_and_si256(_mm256_and_si256(
+				_mm256_shuffle_epi8(byte1High, _mm256_and_si256(_mm256_srli_epi16(previous1, 4), nibble)),
+				_mm256_shuffle_epi8(byte1Low, _mm256_and_si256(previous1, nibble))),
+				_mm256_shuffle_epi8(byte2High, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+
+			must23 = _mm256_or_si256(_mm256_subs_epu8(previous2, _mm256_set1_epi8(0xE0 - 0x80)), _mm256_subs_epu8(previous3, _mm256_set1_epi8((int8)(0xF0 - 0x80))));
+			must23 = _mm256_and_si256(must23, _mm256_set1_epi8((int8)0x80));
+
+			error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+		}
+
+		previousIncomplete = _mm256_subs_epu8(input, incompleteLimit);
+		previous = input;
+	}
+
+	return _mm256_testz_si256(error, error);
+}
+
+#endif
+
+/* Returns the block size of the vector validator for this CPU, or 0 if there is none. */
+static uint64 String_GetUTF8Kernel(boolean (**kernel)(uint8*, uint64)) {
+#ifdef INTRINSICS_X86
+	uint32 features;
+
+	features = Memory_GetCPUFeatures();
+
+	if (features & MEMORY_CPU_AVX2) {
+		*kernel = String_ValidateUTF8AVX2;
+		return 32;
+	}
+
+	if (features & MEMORY_CPU_SSE41) {
+		*kernel = String_ValidateUTF8SSE41;
+		return 16;
+	}
+#endif
+
+	*kernel = NULL;
+	return 0;
+}
+
+/* Runs the RFC 3629 state machine over bytes one at a time, skipping eight ASCII bytes at once between sequences. */
+static void String_ValidateUTF8Scalar(String_UTF8Validator* self, uint8* bytes, uint64 length) {
+	uint64 i;
+	uint8 byte;
+
+	for (i = 0; i < length && !self->Invalid; i++) {
+		if (self->Remaining == 0) {
+			while (i + 8 <= length && (*(uint64*)(bytes + i) & 0x8080808080808080ULL) == 0)
+				i += 8;
+
+			if (i == length)
+				break;
+		}
+
+		byte = bytes[i];
+
+		if (self->Remaining != 0) {
+			if (byte < self->Lower || byte > self->Upper)
+				self->Invalid = true;
+
+			self->Remaining--;
+			self->Lower = 0x80;
+			self->Upper = 0xBF;
+		}
+		else if (byte < 0x80) {
+			continue;
+		}
+		else if (byte < 0xC2) { /* a stray continuation byte or an overlong two byte sequence */
+			self->Invalid = true;
+		}
+		else if (byte < 0xE0) {
+			self->Remaining = 1;
+		}
+		else if (byte < 0xF0) {
+			self->Remaining = 2;
+			self->Lower = byte == 0xE0 ? 0xA0 : 0x80; /* overlong */
+			self->Upper = byte == 0xED ? 0x9F : 0xBF; /* surrogates */
+		}
+		else if (byte < 0xF5) {
+			self->Remaining = 3;
+			self->Lower = byte == 0xF0 ? 0x90 : 0x80; /* overlong */
+			self->Upper = byte == 0xF4 ? 0x8F : 0xBF; /* above U+10FFFF */
+		}
+		else {
+			self->Invalid = true;
+		}
+	}
+}
+
+/**
+ * Prepares a validator for a new UTF-8 stream.
+ */
+void String_UTF8Validator_Initialize(String_UTF8Validator* validator) {
+	assert(validator != NULL);
+
+	validator->Remaining = 0;
+	validator->Lower = 0x80;
+	validator->Upper = 0xBF;
+	validator->Invalid = false;
+}
+
+/**
+ * Validates the next chunk of a UTF-8 stream. A sequence may be split across
+ * chunks; its state is carried to the next call.
+ *
+ * @param self Validator to update
+ * @param bytes Next chunk of the stream
+ * @param length Number of bytes in @a bytes
+ * @returns false once the stream is known to be invalid
+ */
+boolean String_UTF8Validator_Update(String_UTF8Validator* self, uint8* bytes, uint64 length) {
+	boolean (*kernel)(uint8*, uint64);
+	uint64 blockSize;
+	uint64 start;
+	uint64 end;
+	uint64 i;
+
+	assert(self != NULL);
+	assert(bytes != NULL || length == 0);
+
+	/* finish a sequence carried over from the previous chunk */
+	for (start = 0; start < length && self->Remaining != 0 && !self->Invalid; start++)
+		String_ValidateUTF8Scalar(self, bytes + start, 1);
+
+	blockSize = String_GetUTF8Kernel(&kernel);
+
+	if (blockSize != 0 && !self->Invalid && length - start >= blockSize) {
+		end = start + (length - start) / blockSize * blockSize;
+
+		if (!kernel(bytes + start, end - start)) {
+			self->Invalid = true;
+			return false;
+		}
+
+		/* back up to the lead byte of a sequence the blocks may have cut off and let the state machine take over there */
+		for (i = end; i > start && end - i < 3 && (bytes[i - 1] & 0xC0) == 0x80; i--)
+			;
+
+		if (i > start && bytes[i - 1] >= 0xC0)
+			i--;
+
+		start = i;
+	}
+
+	String_ValidateUTF8Scalar(self, bytes + start, length - start);
+
+	return !self->Invalid;
+}
+
+/**
+ * Ends a UTF-8 stream.
+ *
+ * @returns true if every chunk was valid and the stream did not stop in the
+ * middle of a sequence
+ */
+boolean String_UTF8Validator_Finish(String_UTF8Validator* self) {
+	assert(self != NULL);
+
+	return !self->Invalid && self->Remaining == 0;
+}
+
+/**
+ * @returns true if @a bytes is well-formed UTF-8 as defined by RFC 3629: no
+ * overlong forms, surrogates, or code points above U+10FFFF.
+ */
+boolean String_IsUTF8Bytes(uint8* bytes, uint64 length) {
+	String_UTF8Validator validator;
+
+	String_UTF8Validator_Initialize(&validator);
+	String_UTF8Validator_Update(&validator, bytes, length);
+
+	return String_UTF8Validator_Finish(&validator);
 }
 
 boolean String_IsUTF8(String* self) {
-	uint16 length = self->Length;
-	uint8 byte = 0;
-	uint8 bytesToFind = 0;
-	uint8 i;
-	uint8* bytes;
+	assert(self != NULL);
+
+	return String_IsUTF8Bytes(String_GetData(self), self->Length);
+}
+
+#define STRING_INTERN_INITIAL_SLOTS 256
+#define STRING_INTERN_BLOCK_SIZE (64 * 1024)
+
+struct String_InternSlots {
+	uint64 Mask;
+	String_Interned* volatile Entries[1]; /* Mask + 1 slots, allocated inline */
+};
+
+static String_InternSlots* String_InternTable_AllocateSlots(String_InternTable* self, uint64 count) {
+	String_InternSlots* slots;
+
+	slots = (String_InternSlots*)Memory_Arena_Allocate(&self->Storage, sizeof(String_InternSlots) + (count - 1) * sizeof(String_Interned*));
+	slots->Mask = count - 1;
+	memset((void*)slots->Entries, 0, (size_t)(count * sizeof(String_Interned*)));
+
+	return slots;
+}
+
+/* Linear probe for the string. Returns NULL and sets slotIndex to the empty slot that ended the search if it is absent. */
+static String_Interned* String_InternSlots_Find(String_InternSlots* slots, uint64 hash, uint8* bytes, uint64 length, uint64* slotIndex) {
+	String_Interned* entry;
+	uint64 i;
+
+	for (i = hash & slots->Mask; (entry = slots->Entries[i]) != NULL; i = (i + 1) & slots->Mask)
+		if (entry->Hash == hash && entry->Length == length && memcmp(entry->Data, bytes, (size_t)length) == 0)
+			return entry;
+
+	if (slotIndex)
+		*slotIndex = i;
 
-	bytes = Array_Read(&self->Data, 0, self->Length);
-
-	for (byte = bytes[i = 0]; i < length; byte = bytes[++i])
-		if (bytesToFind == 0)
-			if ((byte >> 1) == 126)
-				bytesToFind = 5;
-			else if ((byte >> 2) == 62)
-				bytesToFind = 4;
-			else if ((byte >> 3) == 30)
-				bytesToFind = 3;
-			else if ((byte >> 4) == 14)
-				bytesToFind = 2;
-			else if ((byte >> 5) == 6)
-				bytesToFind = 1;
-			else if ((byte >> 7) == 0) 
-				;
+	return NULL;
+}
+
+/*
+ * Replaces the slot array with one twice the size. The old array stays in the
+ * arena because lock-free readers may still be probing it; a reader that
+ * misses there retries under the lock against the new array.
+ */
+static void String_InternTable_Grow(String_InternTable* self) {
+	String_InternSlots* oldSlots;
+	String_InternSlots* newSlots;
+	String_Interned* entry;
+	uint64 index;
+	uint64 i;
+
+	oldSlots = self->Slots;
+	newSlots = String_InternTable_AllocateSlots(self, (oldSlots->Mask + 1) * 2);
+
+	for (i = 0; i <= oldSlots->Mask; i++) {
+		if ((entry = oldSlots->Entries[i]) == NULL)
+			continue;
+
+		for (index = entry->Hash & newSlots->Mask; newSlots->Entries[index] != NULL; index = (index + 1) & newSlots->Mask)
+			;
+
+		newSlots->Entries[index] = entry;
+	}
+
+	Atomic_Fence();
+	self->Slots = newSlots;
+}
+
+String_InternTable* String_InternTable_New(void) {
+	String_InternTable* table;
+
+	table = Allocate(String_InternTable);
+	String_InternTable_Initialize(table);
+
+	return table;
+}
+
+void String_InternTable_Initialize(String_InternTable* table) {
+	assert(table != NULL);
+
+	Memory_Arena_Initialize(&table->Storage, STRING_INTERN_BLOCK_SIZE);
+	table->Slots = String_InternTable_AllocateSlots(table, STRING_INTERN_INITIAL_SLOTS);
+	table->Count = 0;
+	table->Bytes = 0;
+	table->Lookups = 0;
+	table->Hits = 0;
+	table->BytesSaved = 0;
+	table->Lock = 0;
+}
+
+void String_InternTable_Free(String_InternTable* self) {
+	assert(self != NULL);
+
+	String_InternTable_Uninitialize(self);
+	Free(self);
+}
+
+/**
+ * Releases every interned string at once; handles from this table must not be
+ * used afterwards.
+ */
+void String_InternTable_Uninitialize(String_InternTable* self) {
+	assert(self != NULL);
+
+	Memory_Arena_Uninitialize(&self->Storage);
+	self->Slots = NULL;
+	self->Count = 0;
+	self->Bytes = 0;
+}
+
+String_InternStats String_InternTable_GetStats(String_InternTable* self) {
+	String_InternStats stats;
+
+	assert(self != NULL);
+
+	SpinLock_Acquire(&self->Lock);
+	stats.Count = self->Count;
+	stats.Bytes = self->Bytes;
+	SpinLock_Release(&self->Lock);
+
+	stats.Lookups = self->Lookups;
+	stats.Hits = self->Hits;
+	stats.BytesSaved = self->BytesSaved;
+	stats.HitRate = stats.Lookups ? (float64)stats.Hits / (float64)stats.Lookups : 0.0;
+
+	return stats;
+}
+
+static String_Interned* String_InternHashed(String_InternTable* table, uint8* bytes, uint64 length, uint64 hash) {
+	String_Interned* entry;
+	uint64 index;
+
+	Atomic_Add64(&table->Lookups, 1);
+
+	entry = String_InternSlots_Find(table->Slots, hash, bytes, length, NULL);
+
+	if (entry == NULL) {
+		SpinLock_Acquire(&table->Lock);
+
+		/* another thread may have added it, or grown the table, since the unlocked probe */
+		entry = String_InternSlots_Find(table->Slots, hash, bytes, length, &index);
+
+		if (entry == NULL) {
+			entry = (String_Interned*)Memory_Arena_Allocate(&table->Storage, sizeof(String_Interned) + length);
+			entry->Hash = hash;
+			entry->Length = length;
+			memcpy(entry->Data, bytes, (size_t)length);
+			entry->Data[length] = '\0';
+
+			/* readers must never see the slot before the entry it points to is complete */
+			Atomic_Fence();
+			table->Slots->Entries[index] = entry;
+
+			table->Count++;
+			table->Bytes += length;
+
+			if (table->Count * 2 > table->Slots->Mask + 1)
+				String_InternTable_Grow(table);
+
+			SpinLock_Release(&table->Lock);
+
+			return entry;
+		}
+
+		SpinLock_Release(&table->Lock);
+	}
+
+	Atomic_Add64(&table->Hits, 1);
+	Atomic_Add64(&table->BytesSaved, length);
+
+	return entry;
+}
+
+/**
+ * Returns the canonical copy of @a bytes, storing it first if this is the
+ * first time the table has seen it. Safe to call from several threads.
+ */
+String_Interned* String_InternBytes(String_InternTable* table, uint8* bytes, uint64 length) {
+	assert(table != NULL);
+	assert(bytes != NULL || length == 0);
+
+	return String_InternHashed(table, bytes, length, String_HashBytes(bytes, length));
+}
+
+/* Like String_InternBytes, but reuses the string's cached hash. */
+String_Interned* String_Intern(String_InternTable* table, String* string) {
+	assert(table != NULL);
+	assert(string != NULL);
+
+	return String_InternHashed(table, String_GetData(string), string->Length, String_Hash(string));
+}
+
+/**
+ * @returns the interned bytes; they are followed by a terminating zero so
+ * the view's Data can also be passed where a C string is expected.
+ */
+ArrayView String_Interned_View(String_Interned* self) {
+	ArrayView view;
+
+	assert(self != NULL);
+
+	view.Data = self->Data;
+	view.Size = self->Length;
+
+	return view;
+}
+
+#define STRING_FLOAT64_MANTISSA_BITS 52
+#define STRING_FLOAT64_EXPONENT_BITS 11
+#define STRING_FLOAT64_BIAS 1023
+#define STRING_FLOAT64_MAX_LENGTH 32 /* sign, 17 digits, up to 6 zeros after the point, the point itself */
+#define STRING_PARSE_EXACT_DIGITS 19 /* significant digits that always fit in a uint64 */
+#define STRING_PARSE_MAX_DIGITS 768 /* significant digits that can affect the rounding of a float64 */
+#define STRING_PARSE_MAX_EXPONENT 100000
+#define STRING_FLOAT64_NAN 0x7FF8000000000000ULL
+#define STRING_FLOAT64_NEGATIVE_NAN 0xFFF8000000000000ULL
+#define STRING_FLOAT64_INFINITY 0x7FF0000000000000ULL
+#define STRING_FLOAT64_NEGATIVE_INFINITY 0xFFF0000000000000ULL
+
+static const int8 STRING_DIGIT_PAIRS[201] = "00010203040506070809101112131415161718192021222324252627282930313233343536373839404142434445464748495051525354555657585960616263646566676869707172737475767778798081828384858687888990919293949596979899";
+
+static const uint64 STRING_POWERS_OF_10[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+	10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+	1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* every power of ten up to 1e22 is exactly representable */
+static const float64 STRING_EXACT_POWERS_OF_10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/* log10(2) is about 1233/4096, which gives the digit count from the bit length with at most one correction. */
+static uint32 String_CountDigits(uint64 value) {
+	uint32 estimate;
+
+	estimate = ((64 - CountLeadingZeros64(value | 1)) * 1233) >> 12;
+
+	return estimate + ((value | 1) >= STRING_POWERS_OF_10[estimate]);
+}
+
+/* Writes the decimal digits of value so that the last one lands just before end, two at a time from the pair table. */
+static void String_WriteDigits(uint8* end, uint64 value) {
+	uint64 pair;
+
+	while (value >= 100) {
+		pair = (value % 100) * 2;
+		value /= 100;
+		end -= 2;
+		end[0] = STRING_DIGIT_PAIRS[pair];
+		end[1] = STRING_DIGIT_PAIRS[pair + 1];
+	}
+
+	if (value >= 10) {
+		end -= 2;
+		end[0] = STRING_DIGIT_PAIRS[value * 2];
+		end[1] = STRING_DIGIT_PAIRS[value * 2 + 1];
+	}
+	else {
+		*--end = (uint8)('0' + value);
+	}
+}
+
+/* Returns a pointer to room for count more bytes at the end of the string, which the caller is about to fill. */
+static uint8* String_Extend(String* self, uint64 count) {
+	String_Reserve(self, self->Length + count);
+	self->Hash = 0;
+
+	return String_GetData(self) + self->Length;
+}
+
+void String_AppendUInt64(String* self, uint64 value) {
+	uint32 count;
+	uint8* end;
+
+	assert(self != NULL);
+
+	count = String_CountDigits(value);
+	end = String_Extend(self, count) + count;
+
+	String_WriteDigits(end, value);
+	*end = '\0';
+	self->Length += count;
+}
+
+void String_AppendInt64(String* self, int64 value) {
+	uint64 magnitude;
+	uint32 count;
+	uint8* start;
+
+	assert(self != NULL);
+
+	magnitude = value < 0 ? 0 - (uint64)value : (uint64)value;
+	count = String_CountDigits(magnitude) + (value < 0);
+	start = String_Extend(self, count);
+
+	if (value < 0)
+		*start = '-';
+
+	String_WriteDigits(start + count, magnitude);
+	start[count] = '\0';
+	self->Length += count;
+}
+
+static int32 String_Pow5Bits(int32 exponent) {
+	return (int32)(((uint32)exponent * 1217359) >> 19) + 1;
+}
+
+static int32 String_Log10Pow2(int32 exponent) {
+	return (int32)(((uint32)exponent * 78913) >> 18);
+}
+
+static int32 String_Log10Pow5(int32 exponent) {
+	return (int32)(((uint32)exponent * 732923) >> 20);
+}
+
+static boolean String_IsMultipleOfPowerOf5(uint64 value, int32 power) {
+	int32 count;
+
+	for (count = 0; value % 5 == 0; value /= 5)
+		count++;
+
+	return count >= power;
+}
+
+/* (m * multiplier) >> shift, where multiplier is the 128-bit table entry and 64 < shift < 128 */
+static uint64 String_MultiplyShift(uint64 m, const uint64* multiplier, int32 shift) {
+	uint64 high0, high1, low1, sum;
+
+	Multiply128(m, multiplier[0], &high0);
+	low1 = Multiply128(m, multiplier[1], &high1);
+
+	sum = high0 + low1;
+	high1 += sum < high0;
+	shift -= 64;
+
+	return (high1 << (64 - shift)) | (sum >> shift);
+}
+
+/*
+ * Finds the shortest decimal that rounds back to the float with this mantissa
+ * and exponent, following Adams, "Ryu: Fast Float-to-String Conversion". The
+ * interval of decimals that round to the float is computed exactly with the
+ * power-of-five tables, then digits are removed while both ends of the
+ * interval still differ.
+ */
+static uint64 String_ShortestDecimal(uint64 ieeeMantissa, uint32 ieeeExponent, int32* decimalExponent) {
+	int32 e2, e10, q, k, i, j;
+	uint64 m2, mv, vr, vp, vm, output;
+	uint32 mmShift;
+	boolean acceptBounds, vmIsTrailingZeros, vrIsTrailingZeros, roundUp;
+	uint8 lastRemovedDigit;
+	int32 removed;
+
+	if (ieeeExponent == 0) {
+		e2 = 1 - STRING_FLOAT64_BIAS - STRING_FLOAT64_MANTISSA_BITS - 2;
+		m2 = ieeeMantissa;
+	}
+	else {
+		e2 = (int32)ieeeExponent - STRING_FLOAT64_BIAS - STRING_FLOAT64_MANTISSA_BITS - 2;
+		m2 = (1ULL << STRING_FLOAT64_MANTISSA_BITS) | ieeeMantissa;
+	}
+
+	acceptBounds = (m2 & 1) == 0;
+	mv = 4 * m2;
+	mmShift = ieeeMantissa != 0 || ieeeExponent <= 1; /* the gap below is half as wide at a power of two */
+	vmIsTrailingZeros = false;
+	vrIsTrailingZeros = false;
+
+	if (e2 >= 0) {
+		q = String_Log10Pow2(e2) - (e2 > 3);
+		e10 = q;
+		k = FLOAT_POW5_INV_BITCOUNT + String_Pow5Bits(q) - 1;
+		i = -e2 + q + k;
+
+		vr = String_MultiplyShift(4 * m2, FLOAT_POW5_INV_SPLIT[q], i);
+		vp = String_MultiplyShift(4 * m2 + 2, FLOAT_POW5_INV_SPLIT[q], i);
+		vm = String_MultiplyShift(4 * m2 - 1 - mmShift, FLOAT_POW5_INV_SPLIT[q], i);
+
+		if (q <= 21) {
+			if (mv % 5 == 0)
+				vrIsTrailingZeros = String_IsMultipleOfPowerOf5(mv, q);
+			else if (acceptBounds)
+				vmIsTrailingZeros = String_IsMultipleOfPowerOf5(mv - 1 - mmShift, q);
 			else
-				return false;
-		else
-			if ((byte >> 6) == 2)
-				bytesToFind--;
+				vp -= String_IsMultipleOfPowerOf5(mv + 2, q);
+		}
+	}
+	else {
+		q = String_Log10Pow5(-e2) - (-e2 > 1);
+		e10 = q + e2;
+		i = -e2 - q;
+		k = String_Pow5Bits(i) - FLOAT_POW5_BITCOUNT;
+		j = q - k;
+
+		vr = String_MultiplyShift(4 * m2, FLOAT_POW5_SPLIT[i], j);
+		vp = String_MultiplyShift(4 * m2 + 2, FLOAT_POW5_SPLIT[i], j);
+		vm = String_MultiplyShift(4 * m2 - 1 - mmShift, FLOAT_POW5_SPLIT[i], j);
+
+		if (q <= 1) {
+			vrIsTrailingZeros = true;
+
+			if (acceptBounds)
+				vmIsTrailingZeros = mmShift == 1;
 			else
-				return false;
+				vp--;
+		}
+		else if (q < 63) {
+			vrIsTrailingZeros = (mv & ((1ULL << q) - 1)) == 0;
+		}
+	}
+
+	removed = 0;
+	lastRemovedDigit = 0;
+
+	if (vmIsTrailingZeros || vrIsTrailingZeros) {
+		/* rare: exact ties need the removed digits to round correctly */
+		while (vp / 10 > vm / 10) {
+			vmIsTrailingZeros &= vm % 10 == 0;
+			vrIsTrailingZeros &= lastRemovedDigit == 0;
+			lastRemovedDigit = (uint8)(vr % 10);
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		if (vmIsTrailingZeros) {
+			while (vm % 10 == 0) {
+				vrIsTrailingZeros &= lastRemovedDigit == 0;
+				lastRemovedDigit = (uint8)(vr % 10);
+				vr /= 10;
+				vp /= 10;
+				vm /= 10;
+				removed++;
+			}
+		}
+
+		if (vrIsTrailingZeros && lastRemovedDigit == 5 && vr % 2 == 0)
+			lastRemovedDigit = 4; /* round half to even */
+
+		output = vr + ((vr == vm && (!acceptBounds || !vmIsTrailingZeros)) || lastRemovedDigit >= 5);
+	}
+	else {
+		roundUp = false;
+
+		if (vp / 100 > vm / 100) {
+			roundUp = vr % 100 >= 50;
+			vr /= 100;
+			vp /= 100;
+			vm /= 100;
+			removed += 2;
+		}
+
+		while (vp / 10 > vm / 10) {
+			roundUp = vr % 10 >= 5;
+			vr /= 10;
+			vp /= 10;
+			vm /= 10;
+			removed++;
+		}
+
+		output = vr + (vr == vm || roundUp);
+	}
+
+	*decimalExponent = e10 + removed;
+
+	return output;
+}
+
+/**
+ * Appends the shortest decimal text that parses back to exactly @a value.
+ * Magnitudes from 1e-6 up to but not including 1e21 are written in positional
+ * form ("0.001", "123.5", "100"), the rest as "1.5e+21" or "2e-7", as
+ * JavaScript does. Non-finite values are written as "NaN", "Infinity" and
+ * "-Infinity".
+ */
+void String_AppendFloat64(String* self, float64 value) {
+	uint64 bits;
+	uint64 ieeeMantissa;
+	uint32 ieeeExponent;
+	uint64 digits;
+	int32 exponent;
+	int32 point;
+	uint32 count;
+	uint8 text[STRING_FLOAT64_MAX_LENGTH];
+	uint8* out;
+
+	assert(self != NULL);
+
+	memcpy(&bits, &value, sizeof(bits));
+	ieeeMantissa = bits & ((1ULL << STRING_FLOAT64_MANTISSA_BITS) - 1);
+	ieeeExponent = (uint32)(bits >> STRING_FLOAT64_MANTISSA_BITS) & ((1 << STRING_FLOAT64_EXPONENT_BITS) - 1);
+
+	if (ieeeExponent == (1 << STRING_FLOAT64_EXPONENT_BITS) - 1) {
+		String_AppendCString(self, ieeeMantissa ? "NaN" : (bits >> 63) ? "-Infinity" : "Infinity");
+		return;
+	}
+
+	out = text;
+
+	if (bits >> 63)
+		*out++ = '-';
+
+	if (ieeeExponent == 0 && ieeeMantissa == 0) {
+		*out++ = '0';
+		String_AppendBytes(self, (int8*)text, out - text);
+		return;
+	}
+
+	digits = String_ShortestDecimal(ieeeMantissa, ieeeExponent, &exponent);
+	count = String_CountDigits(digits);
+	point = (int32)count + exponent;
+
+	if (point > 0 && point <= 21) {
+		if (exponent >= 0) {
+			String_WriteDigits(out + count, digits);
+			out += count;
+			memset(out, '0', exponent);
+			out += exponent;
+		}
+		else {
+			String_WriteDigits(out + count + 1, digits);
+			memmove(out, out + 1, point);
+			out[point] = '.';
+			out += count + 1;
+		}
+	}
+	else if (point <= 0 && point > -6) {
+		*out++ = '0';
+		*out++ = '.';
+		memset(out, '0', -point);
+		out += -point;
+		String_WriteDigits(out + count, digits);
+		out += count;
+	}
+	else {
+		String_WriteDigits(out + count + 1, digits);
+		out[0] = out[1];
+
+		if (count > 1) {
+			out[1] = '.';
+			out += count + 1;
+		}
+		else {
+			out += 1;
+		}
+
+		*out++ = 'e';
+		*out++ = point - 1 < 0 ? '-' : '+';
+		exponent = point - 1 < 0 ? 1 - point : point - 1;
+		count = String_CountDigits(exponent);
+		String_WriteDigits(out + count, exponent);
+		out += count;
+	}
+
+	String_AppendBytes(self, (int8*)text, out - text);
+}
+
+/* Reads a run of decimal digits. Returns the number consumed, or 0 if there are none or the value does not fit. */
+static uint64 String_ParseDigits(uint8* bytes, uint64 length, uint64* value) {
+	uint64 result;
+	uint64 chunk;
+	uint64 digit;
+	uint64 i;
+
+	result = 0;
+	i = 0;
+
+#ifdef INTRINSICS_LITTLE_ENDIAN
+	/* eight digits at a time: check them all with one mask, then combine pairs, quads and halves with three multiplies */
+	while (length - i >= 8 && result < 100000000000ULL) {
+		memcpy(&chunk, bytes + i, 8);
+
+		if ((((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) != 0x3333333333333333ULL))
+			break;
+
+		chunk = ((chunk & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+		chunk = ((chunk & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+		chunk = ((chunk & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
+
+		result = result * 100000000 + chunk;
+		i += 8;
+	}
+#endif
+
+	for (; i < length && (digit = (uint64)(bytes[i] - '0')) <= 9; i++) {
+		if (result > (0xFFFFFFFFFFFFFFFFULL - digit) / 10)
+			return 0;
+
+		result = result * 10 + digit;
+	}
+
+	*value = result;
+
+	return i;
+}
+
+/**
+ * Parses an optionally '+' prefixed decimal integer from the start of @a text.
+ *
+ * @returns the number of bytes consumed, or 0 if @a text does not start with
+ * a number or the number does not fit in a uint64
+ */
+uint64 String_ParseUInt64(ArrayView text, uint64* value) {
+	uint64 sign;
+	uint64 count;
+
+	assert(value != NULL);
+
+	sign = text.Size != 0 && text.Data[0] == '+';
+	count = String_ParseDigits(text.Data + sign, text.Size - sign, value);
+
+	return count ? count + sign : 0;
+}
+
+/**
+ * Parses an optionally signed decimal integer from the start of @a text.
+ *
+ * @returns the number of bytes consumed, or 0 if @a text does not start with
+ * a number or the number does not fit in an int64
+ */
+uint64 String_ParseInt64(ArrayView text, int64* value) {
+	uint64 magnitude;
+	boolean negative;
+	uint64 sign;
+	uint64 count;
+
+	assert(value != NULL);
+
+	negative = text.Size != 0 && text.Data[0] == '-';
+	sign = text.Size != 0 && (text.Data[0] == '-' || text.Data[0] == '+');
+	count = String_ParseDigits(text.Data + sign, text.Size - sign, &magnitude);
+
+	if (count == 0 || magnitude > 0x7FFFFFFFFFFFFFFFULL + negative)
+		return 0;
+
+	*value = negative ? (int64)(0 - magnitude) : (int64)magnitude;
+
+	return count + sign;
+}
+
+static float64 String_Float64FromBits(uint64 bits) {
+	float64 value;
+
+	memcpy(&value, &bits, sizeof(value));
+
+	return value;
+}
+
+/* Case-insensitive prefix match against a lowercase word. */
+static boolean String_MatchesWord(uint8* bytes, uint64 length, int8* word) {
+	uint64 i;
+
+	for (i = 0; word[i] != '\0'; i++)
+		if (i >= length || (bytes[i] | 0x20) != (uint8)word[i])
+			return false;
+
+	return true;
+}
+
+/*
+ * Parses the digits of a number that did not qualify for the exact fast path.
+ * At most STRING_PARSE_MAX_DIGITS significant digits can change how a float64
+ * rounds, so later digits are replaced with a single nonzero one if any of
+ * them are nonzero, and the result is handed to strtod without a decimal
+ * point so the C locale does not matter.
+ */
+static float64 String_ParseFloat64Slow(uint8* bytes, uint64 length, int32 exponent) {
+	int8 buffer[STRING_PARSE_MAX_DIGITS + 16];
+	uint32 kept;
+	boolean pointSeen;
+	boolean sticky;
+	uint64 magnitude;
+	uint32 count;
+	uint64 i;
+
+	kept = 0;
+	pointSeen = false;
+	sticky = false;
+
+	buffer[kept++] = '+';
+
+	for (i = 0; i < length; i++) {
+		if (bytes[i] == '.') {
+			pointSeen = true;
+		}
+		else if (kept == 1 && bytes[i] == '0') {
+			exponent -= pointSeen;
+		}
+		else if (kept <= STRING_PARSE_MAX_DIGITS) {
+			buffer[kept++] = bytes[i];
+			exponent -= pointSeen;
+		}
+		else {
+			exponent += !pointSeen;
+			sticky |= bytes[i] != '0';
+		}
+	}
+
+	if (sticky) {
+		buffer[kept++] = '1';
+		exponent--;
+	}
+
+	buffer[kept++] = 'e';
+	buffer[kept++] = exponent < 0 ? '-' : '+';
+	magnitude = exponent < 0 ? (uint64)-exponent : (uint64)exponent;
+	count = String_CountDigits(magnitude);
+	String_WriteDigits((uint8*)buffer + kept + count, magnitude);
+	kept += count;
+	buffer[kept] = '\0';
+
+	return strtod(buffer, NULL);
+}
+
+/**
+ * Parses a decimal floating point number, such as "-12.5e3", ".5" or "7",
+ * or "NaN", "Inf" or "Infinity" in any case, from the start of @a text. The
+ * result is correctly rounded. Numbers with at most 19 significant digits and
+ * a small exponent, which covers most real-world text, are converted with
+ * one exact floating point multiply or divide.
+ *
+ * @returns the number of bytes consumed, or 0 if @a text does not start with
+ * a number
+ */
+uint64 String_ParseFloat64(ArrayView text, float64* value) {
+	uint8* bytes;
+	uint64 length;
+	uint64 i;
+	uint64 start;
+	uint64 digitsEnd;
+	uint64 mantissa;
+	uint64 exponentValue;
+	uint32 significant;
+	int32 exponent;
+	int32 explicitExponent;
+	boolean negative;
+	boolean pointSeen;
+	boolean anyDigits;
+	boolean exponentNegative;
+	float64 result;
+
+	assert(value != NULL);
+
+	bytes = text.Data;
+	length = text.Size;
+	i = 0;
+
+	negative = length != 0 && bytes[0] == '-';
+	if (length != 0 && (bytes[0] == '-' || bytes[0] == '+'))
+		i++;
+
+	if (String_MatchesWord(bytes + i, length - i, "nan")) {
+		*value = String_Float64FromBits(negative ? STRING_FLOAT64_NEGATIVE_NAN : STRING_FLOAT64_NAN);
+		return i + 3;
+	}
+
+	if (String_MatchesWord(bytes + i, length - i, "inf")) {
+		*value = String_Float64FromBits(negative ? STRING_FLOAT64_NEGATIVE_INFINITY : STRING_FLOAT64_INFINITY);
+		return i + (String_MatchesWord(bytes + i, length - i, "infinity") ? 8 : 3);
+	}
+
+	start = i;
+	mantissa = 0;
+	significant = 0;
+	exponent = 0;
+	pointSeen = false;
+	anyDigits = false;
+
+	for (; i < length; i++) {
+		if (bytes[i] == '.' && !pointSeen) {
+			pointSeen = true;
+			continue;
+		}
+
+		if ((uint8)(bytes[i] - '0') > 9)
+			break;
+
+		anyDigits = true;
+
+		if (significant == 0 && bytes[i] == '0') {
+			exponent -= pointSeen;
+		}
+		else if (significant < STRING_PARSE_EXACT_DIGITS) {
+			mantissa = mantissa * 10 + (bytes[i] - '0');
+			exponent -= pointSeen;
+			significant++;
+		}
+		else {
+			exponent += !pointSeen;
+			significant += significant != 0xFFFFFFFF;
+		}
+	}
+
+	if (!anyDigits)
+		return 0;
+
+	digitsEnd = i;
+	explicitExponent = 0;
+
+	if (i < length && (bytes[i] | 0x20) == 'e') {
+		i++;
+		exponentNegative = i < length && bytes[i] == '-';
+		i += i < length && (bytes[i] == '-' || bytes[i] == '+');
+
+		if (i < length && (uint8)(bytes[i] - '0') <= 9) {
+			/* an exponent too large to parse is far beyond the float64 range either way */
+			for (exponentValue = 0; i < length && (uint8)(bytes[i] - '0') <= 9; i++)
+				if (exponentValue < STRING_PARSE_MAX_EXPONENT)
+					exponentValue = exponentValue * 10 + (bytes[i] - '0');
+
+			explicitExponent = exponentNegative ? -(int32)exponentValue : (int32)exponentValue;
+		}
+		else {
+			i = digitsEnd; /* an 'e' without digits is not part of the number */
+		}
+	}
+
+	exponent += explicitExponent;
+
+	if (mantissa == 0)
+		result = 0.0;
+	else if (significant <= STRING_PARSE_EXACT_DIGITS && mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+		result = exponent < 0 ? (float64)mantissa / STRING_EXACT_POWERS_OF_10[-exponent] : (float64)mantissa * STRING_EXACT_POWERS_OF_10[exponent];
+	else
+		result = String_ParseFloat64Slow(bytes + start, digitsEnd - start, explicitExponent);
+
+	*value = negative ? -result : result;
+
+	return i;
+}
+
+#ifdef INTRINSICS_X86
+
+/*
+ * Set membership for 16 (or 32) bytes at once: one shuffle looks up the high
+ * nibbles allowed with each byte's low nibble, another turns each byte's high
+ * nibble into a bit, and a byte is in the set where the two overlap. Bytes
+ * of 0x80 and up map to no bit, so this is exact for sets of ASCII bytes.
+ */
+static uint64 TARGET("ssse3") String_ByteSet_FindSSSE3(String_ByteSet* self, uint8* bytes, uint64 length) {
+	__m128i lowTable, bitTable, nibble, input, matches;
+	uint32 mask;
+	uint64 i;
+
+	lowTable = _mm_loadu_si128((__m128i*)self->LowNibbles);
+	bitTable = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+	nibble = _mm_set1_epi8(0x0F);
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		input = _mm_loadu_si128((__m128i*)(bytes + i));
+		matches = _mm_and_si128(_mm_shuffle_epi8(lowTable, _mm_and_si128(input, nibble)), _mm_shuffle_epi8(bitTable, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+		mask = ~(uint32)_mm_movemask_epi8(_mm_cmpeq_epi8(matches, _mm_setzero_si128())) & 0xFFFF;
+
+		if (mask)
+			return i + CountTrailingZeros(mask);
+	}
+
+	for (; i < length; i++)
+		if (self->Bitmap[bytes[i] >> 5] & (1U << (bytes[i] & 31)))
+			return i;
+
+	return STRING_NOT_FOUND;
+}
+
+static uint64 TARGET("avx2") String_ByteSet_FindAVX2(String_ByteSet* self, uint8* bytes, uint64 length) {
+	__m256i lowTable, bitTable, nibble, input, matches;
+	uint32 mask;
+	uint64 i;
+	uint64 found;
+
+	lowTable = _mm256_broadcastsi128_si256(_mm_loadu_si128((__m128i*)self->LowNibbles));
+	bitTable = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0, 0);
+	nibble = _mm256_set1_epi8(0x0F);
+
+	for (i = 0; i + 32 <= length; i += 32) {
+		input = _mm256_loadu_si256((__m256i*)(bytes + i));
+		matches = _mm256_and_si256(_mm256_shuffle_epi8(lowTable, _mm256_and_si256(input, nibble)), _mm256_shuffle_epi8(bitTable, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+		mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(matches, _mm256_setzero_si256()));
+
+		if (mask)
+			return i + CountTrailingZeros(mask);
+	}
+
+	if (i == length)
+		return STRING_NOT_FOUND;
+
+	found = String_ByteSet_FindSSSE3(self, bytes + i, length - i);
+
+	return found == STRING_NOT_FOUND ? found : i + found;
+}
+
+#endif
+
+static uint64 String_ByteSet_FindScalar(String_ByteSet* self, uint8* bytes, uint64 length) {
+	uint64 i;
+
+	for (i = 0; i < length; i++)
+		if (self->Bitmap[bytes[i] >> 5] & (1U << (bytes[i] & 31)))
+			return i;
+
+	return STRING_NOT_FOUND;
+}
+
+static uint64 String_ByteSet_FindResolve(String_ByteSet* self, uint8* bytes, uint64 length);
+
+static uint64 (*byteSetKernel)(String_ByteSet* self, uint8* bytes, uint64 length) = String_ByteSet_FindResolve;
+
+static uint64 String_ByteSet_FindResolve(String_ByteSet* self, uint8* bytes, uint64 length) {
+#ifdef INTRINSICS_X86
+	uint32 features;
+
+	features = Memory_GetCPUFeatures();
+
+	if (features & MEMORY_CPU_AVX2)
+		byteSetKernel = String_ByteSet_FindAVX2;
+	else if (features & MEMORY_CPU_SSE41)
+		byteSetKernel = String_ByteSet_FindSSSE3;
+	else
+		byteSetKernel = String_ByteSet_FindScalar;
+#else
+	byteSetKernel = String_ByteSet_FindScalar;
+#endif
+
+	return byteSetKernel(self, bytes, length);
+}
+
+/**
+ * Prepares the set of bytes in @a bytes for repeated searches. Order and
+ * duplicates do not matter.
+ */
+void String_ByteSet_Initialize(String_ByteSet* set, ArrayView bytes) {
+	uint64 i;
+
+	assert(set != NULL);
+
+	memset(set, 0, sizeof(String_ByteSet));
+	set->IsASCII = true;
+
+	for (i = 0; i < bytes.Size; i++) {
+		set->Bitmap[bytes.Data[i] >> 5] |= 1U << (bytes.Data[i] & 31);
+
+		if (bytes.Data[i] < 0x80)
+			set->LowNibbles[bytes.Data[i] & 0x0F] |= (uint8)(1 << (bytes.Data[i] >> 4));
+		else
+			set->IsASCII = false;
+	}
+}
+
+/**
+ * @returns the offset of the first byte of @a bytes that is in the set, or
+ * STRING_NOT_FOUND
+ */
+uint64 String_ByteSet_Find(String_ByteSet* self, uint8* bytes, uint64 length) {
+	assert(self != NULL);
+	assert(bytes != NULL || length == 0);
+
+	return self->IsASCII ? byteSetKernel(self, bytes, length) : String_ByteSet_FindScalar(self, bytes, length);
+}
+
+/**
+ * @returns the offset of the first occurrence of @a needle at or after
+ * @a start, or STRING_NOT_FOUND
+ */
+uint64 String_Find(String* self, uint64 start, ArrayView needle) {
+	uint8* data;
+	uint8* found;
+
+	assert(self != NULL);
+
+	if (start > self->Length)
+		return STRING_NOT_FOUND;
+
+	data = String_GetData(self);
+	found = Memory_FindBytes(data + start, self->Length - start, needle.Data, needle.Size);
+
+	return found ? (uint64)(found - data) : STRING_NOT_FOUND;
+}
+
+/**
+ * @returns the offset of the first byte at or after @a start that is any of
+ * the bytes in @a bytes, or STRING_NOT_FOUND
+ */
+uint64 String_FindAny(String* self, uint64 start, ArrayView bytes) {
+	String_ByteSet set;
+	uint64 found;
+
+	assert(self != NULL);
+
+	if (start >= self->Length)
+		return STRING_NOT_FOUND;
+
+	if (bytes.Size == 1)
+		return String_Find(self, start, bytes);
+
+	String_ByteSet_Initialize(&set, bytes);
+	found = String_ByteSet_Find(&set, String_GetData(self) + start, self->Length - start);
+
+	return found == STRING_NOT_FOUND ? found : start + found;
+}
+
+/**
+ * Splits the string at each occurrence of @a separator. The parts are views
+ * into the string and are valid until it is next modified.
+ *
+ * @param parts Receives the parts
+ * @param maxParts Capacity of @a parts. Once it is reached, the last part
+ * holds the rest of the string, separators included.
+ * @returns the number of parts written; a string without the separator is a
+ * single part
+ */
+uint64 String_Split(String* self, ArrayView separator, ArrayView* parts, uint64 maxParts) {
+	uint64 count;
+	uint64 start;
+	uint64 found;
+
+	assert(self != NULL);
+	assert(separator.Size != 0);
+	assert(parts != NULL || maxParts == 0);
+
+	if (maxParts == 0)
+		return 0;
+
+	for (count = 0, start = 0; count + 1 < maxParts && (found = String_Find(self, start, separator)) != STRING_NOT_FOUND; start = found + separator.Size)
+		parts[count++] = ArrayView_FromBytes(String_GetData(self) + start, found - start);
+
+	parts[count++] = ArrayView_FromBytes(String_GetData(self) + start, self->Length - start);
+
+	return count;
+}
+
+/**
+ * Prepares to walk the tokens of @a text. The tokens are views into @a text,
+ * so it must outlive them.
+ *
+ * @param delimiters Bytes that separate tokens. Runs of them and delimiters
+ * at either end produce no empty tokens.
+ */
+void String_Tokenizer_Initialize(String_Tokenizer* tokenizer, ArrayView text, ArrayView delimiters) {
+	assert(tokenizer != NULL);
+
+	tokenizer->Remaining = text;
+	String_ByteSet_Initialize(&tokenizer->Delimiters, delimiters);
+}
+
+/**
+ * @returns false once there are no tokens left, otherwise true with the next
+ * token in @a token
+ */
+boolean String_Tokenizer_Next(String_Tokenizer* self, ArrayView* token) {
+	uint64 end;
+
+	assert(self != NULL);
+	assert(token != NULL);
+
+	while (self->Remaining.Size != 0) {
+		end = String_ByteSet_Find(&self->Delimiters, self->Remaining.Data, self->Remaining.Size);
+
+		if (end == STRING_NOT_FOUND)
+			end = self->Remaining.Size;
+
+		*token = ArrayView_FromBytes(self->Remaining.Data, end);
+		self->Remaining = ArrayView_Slice(self->Remaining, end + (end < self->Remaining.Size), self->Remaining.Size - end - (end < self->Remaining.Size));
+
+		if (end != 0)
+			return true;
+	}
+
+	return false;
+}
+
+#ifdef INTRINSICS_X86
+
+/*
+ * ASCII runs are transcoded a block at a time by zero-extending or packing
+ * the code units. Each kernel stops at the first block that is not all ASCII
+ * and returns how many units it converted; the scalar code takes it from
+ * there.
+ */
+static uint64 TARGET("sse2") String_WidenASCII16SSE2(uint8* input, uint64 length, uint16* output) {
+	__m128i block, zero;
+	uint64 i;
+
+	zero = _mm_setzero_si128();
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		block = _mm_loadu_si128((__m128i*)(input + i));
+
+		if (_mm_movemask_epi8(block))
+			break;
+
+		_mm_storeu_si128((__m128i*)(output + i), _mm_unpacklo_epi8(block, zero));
+		_mm_storeu_si128((__m128i*)(output + i + 8), _mm_unpackhi_epi8(block, zero));
+	}
+
+	return i;
+}
+
+static uint64 TARGET("sse2") String_WidenASCII32SSE2(uint8* input, uint64 length, uint32* output) {
+	__m128i block, zero, low, high;
+	uint64 i;
+
+	zero = _mm_setzero_si128();
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		block = _mm_loadu_si128((__m128i*)(input + i));
+
+		if (_mm_movemask_epi8(block))
+			break;
+
+		low = _mm_unpacklo_epi8(block, zero);
+		high = _mm_unpackhi_epi8(block, zero);
+		_mm_storeu_si128((__m128i*)(output + i), _mm_unpacklo_epi16(low, zero));
+		_mm_storeu_si128((__m128i*)(output + i + 4), _mm_unpackhi_epi16(low, zero));
+		_mm_storeu_si128((__m128i*)(output + i + 8), _mm_unpacklo_epi16(high, zero));
+		_mm_storeu_si128((__m128i*)(output + i + 12), _mm_unpackhi_epi16(high, zero));
+	}
+
+	return i;
+}
+
+static uint64 TARGET("sse2") String_NarrowASCII16SSE2(uint16* input, uint64 count, uint8* output) {
+	__m128i low, high, mask;
+	uint64 i;
+
+	mask = _mm_set1_epi16((int16)0xFF80);
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		low = _mm_loadu_si128((__m128i*)(input + i));
+		high = _mm_loadu_si128((__m128i*)(input + i + 8));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(_mm_or_si128(low, high), mask), _mm_setzero_si128())) != 0xFFFF)
+			break;
+
+		_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(low, high));
+	}
+
+	return i;
+}
+
+static uint64 TARGET("sse2") String_NarrowASCII32SSE2(uint32* input, uint64 count, uint8* output) {
+	__m128i a, b, c, d, mask;
+	uint64 i;
+
+	mask = _mm_set1_epi32((int32)0xFFFFFF80);
+
+	for (i = 0; i + 16 <= count; i += 16) {
+		a = _mm_loadu_si128((__m128i*)(input + i));
+		b = _mm_loadu_si128((__m128i*)(input + i + 4));
+		c = _mm_loadu_si128((__m128i*)(input + i + 8));
+		d = _mm_loadu_si128((__m128i*)(input + i + 12));
+
+		if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_and_si128(_mm_or_si128(_mm_or_si128(a, b), _mm_or_si128(c, d)), mask), _mm_setzero_si128())) != 0xFFFF)
+			break;
+
+		/* every unit is below 0x80, so the signed 32 to 16 bit pack cannot saturate */
+		_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d)));
+	}
+
+	return i;
+}
+
+static uint64 TARGET("avx2") String_WidenASCII16AVX2(uint8* input, uint64 length, uint16* output) {
+	__m256i block;
+	uint64 i;
+
+	for (i = 0; i + 32 <= length; i += 32) {
+		block = _mm256_loadu_si256((__m256i*)(input + i));
+
+		if (_mm256_movemask_epi8(block))
+			break;
+
+		_mm256_storeu_si256((__m256i*)(output + i), _mm256_cvtepu8_epi16(_mm256_castsi256_si128(block)));
+		_mm256_storeu_si256((__m256i*)(output + i + 16), _mm256_cvtepu8_epi16(_mm256_extracti128_si256(block, 1)));
+	}
+
+	return i + String_WidenASCII16SSE2(input + i, length - i, output + i);
+}
+
+static uint64 TARGET("avx2") String_WidenASCII32AVX2(uint8* input, uint64 length, uint32* output) {
+	__m128i block;
+	uint64 i;
+
+	for (i = 0; i + 16 <= length; i += 16) {
+		block = _mm_loadu_si128((__m128i*)(input + i));
+
+		if (_mm_movemask_epi8(block))
+			break;
+
+		_mm256_storeu_si256((__m256i*)(output + i), _mm256_cvtepu8_epi32(block));
+		_mm256_storeu_si256((__m256i*)(output + i + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(block, 8)));
+	}
+
+	return i;
+}
+
+static uint64 TARGET("avx2") String_NarrowASCII16AVX2(uint16* input, uint64 count, uint8* output) {
+	__m256i low, high, mask;
+	uint64 i;
+
+	mask = _mm256_set1_epi16((int16)0xFF80);
+
+	for (i = 0; i + 32 <= count; i += 32) {
+		low = _mm256_loadu_si256((__m256i*)(input + i));
+		high = _mm256_loadu_si256((__m256i*)(input + i + 16));
+
+		if (!_mm256_testz_si256(_mm256_or_si256(low, high), mask))
+			break;
+
+		/* packus works within 128-bit lanes, so the quarters come out as 0, 2, 1, 3 */
+		_mm256_storeu_si256((__m256i*)(output + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(low, high), 0xD8));
+	}
+
+	return i + String_NarrowASCII16SSE2(input + i, count - i, output + i);
+}
+
+#endif
+
+static uint64 String_WidenASCII16Scalar(uint8* input, uint64 length, uint16* output) {
+	uint64 i;
+
+	for (i = 0; i < length && input[i] < 0x80; i++)
+		output[i] = input[i];
+
+	return i;
+}
+
+static uint64 String_WidenASCII32Scalar(uint8* input, uint64 length, uint32* output) {
+	uint64 i;
+
+	for (i = 0; i < length && input[i] < 0x80; i++)
+		output[i] = input[i];
+
+	return i;
+}
+
+static uint64 String_NarrowASCII16Scalar(uint16* input, uint64 count, uint8* output) {
+	uint64 i;
+
+	for (i = 0; i < count && input[i] < 0x80; i++)
+		output[i] = (uint8)input[i];
+
+	return i;
+}
+
+static uint64 String_NarrowASCII32Scalar(uint32* input, uint64 count, uint8* output) {
+	uint64 i;
+
+	for (i = 0; i < count && input[i] < 0x80; i++)
+		output[i] = (uint8)input[i];
+
+	return i;
+}
+
+static void String_ResolveTranscodeKernels(void);
+
+static uint64 String_WidenASCII16Resolve(uint8* input, uint64 length, uint16* output);
+static uint64 String_WidenASCII32Resolve(uint8* input, uint64 length, uint32* output);
+static uint64 String_NarrowASCII16Resolve(uint16* input, uint64 count, uint8* output);
+static uint64 String_NarrowASCII32Resolve(uint32* input, uint64 count, uint8* output);
+
+static uint64 (*widenASCII16Kernel)(uint8* input, uint64 length, uint16* output) = String_WidenASCII16Resolve;
+static uint64 (*widenASCII32Kernel)(uint8* input, uint64 length, uint32* output) = String_WidenASCII32Resolve;
+static uint64 (*narrowASCII16Kernel)(uint16* input, uint64 count, uint8* output) = String_NarrowASCII16Resolve;
+static uint64 (*narrowASCII32Kernel)(uint32* input, uint64 count, uint8* output) = String_NarrowASCII32Resolve;
+
+static void String_ResolveTranscodeKernels(void) {
+#ifdef INTRINSICS_X86
+	uint32 features;
+
+	features = Memory_GetCPUFeatures();
+
+	if (features & MEMORY_CPU_AVX2) {
+		widenASCII16Kernel = String_WidenASCII16AVX2;
+		widenASCII32Kernel = String_WidenASCII32AVX2;
+		narrowASCII16Kernel = String_NarrowASCII16AVX2;
+		narrowASCII32Kernel = String_NarrowASCII32SSE2;
+		return;
+	}
+
+	if (features & MEMORY_CPU_SSE2) {
+		widenASCII16Kernel = String_WidenASCII16SSE2;
+		widenASCII32Kernel = String_WidenASCII32SSE2;
+		narrowASCII16Kernel = String_NarrowASCII16SSE2;
+		narrowASCII32Kernel = String_NarrowASCII32SSE2;
+		return;
+	}
+#endif
+
+	widenASCII16Kernel = String_WidenASCII16Scalar;
+	widenASCII32Kernel = String_WidenASCII32Scalar;
+	narrowASCII16Kernel = String_NarrowASCII16Scalar;
+	narrowASCII32Kernel = String_NarrowASCII32Scalar;
+}
+
+static uint64 String_WidenASCII16Resolve(uint8* input, uint64 length, uint16* output) {
+	String_ResolveTranscodeKernels();
+	return widenASCII16Kernel(input, length, output);
+}
+
+static uint64 String_WidenASCII32Resolve(uint8* input, uint64 length, uint32* output) {
+	String_ResolveTranscodeKernels();
+	return widenASCII32Kernel(input, length, output);
+}
+
+static uint64 String_NarrowASCII16Resolve(uint16* input, uint64 count, uint8* output) {
+	String_ResolveTranscodeKernels();
+	return narrowASCII16Kernel(input, count, output);
+}
+
+static uint64 String_NarrowASCII32Resolve(uint32* input, uint64 count, uint8* output) {
+	String_ResolveTranscodeKernels();
+	return narrowASCII32Kernel(input, count, output);
+}
+
+/* Decodes one code point from UTF-8 that has already been validated and advances past it. */
+static uint32 String_DecodeValidUTF8(uint8* bytes, uint64* position) {
+	uint8* at;
+
+	at = bytes + *position;
+
+	if (at[0] < 0x80) {
+		*position += 1;
+		return at[0];
+	}
+
+	if (at[0] < 0xE0) {
+		*position += 2;
+		return ((uint32)(at[0] & 0x1F) << 6) | (at[1] & 0x3F);
+	}
+
+	if (at[0] < 0xF0) {
+		*position += 3;
+		return ((uint32)(at[0] & 0x0F) << 12) | ((uint32)(at[1] & 0x3F) << 6) | (at[2] & 0x3F);
+	}
+
+	*position += 4;
+	return ((uint32)(at[0] & 0x07) << 18) | ((uint32)(at[1] & 0x3F) << 12) | ((uint32)(at[2] & 0x3F) << 6) | (at[3] & 0x3F);
+}
+
+/* Encodes a code point known to be a valid scalar value and returns the number of bytes written. */
+static uint8 String_EncodeUTF8(uint32 codePoint, uint8* output) {
+	if (codePoint < 0x80) {
+		output[0] = (uint8)codePoint;
+		return 1;
+	}
+
+	if (codePoint < 0x800) {
+		output[0] = (uint8)(0xC0 | (codePoint >> 6));
+		output[1] = (uint8)(0x80 | (codePoint & 0x3F));
+		return 2;
+	}
+
+	if (codePoint < 0x10000) {
+		output[0] = (uint8)(0xE0 | (codePoint >> 12));
+		output[1] = (uint8)(0x80 | ((codePoint >> 6) & 0x3F));
+		output[2] = (uint8)(0x80 | (codePoint & 0x3F));
+		return 3;
+	}
+
+	output[0] = (uint8)(0xF0 | (codePoint >> 18));
+	output[1] = (uint8)(0x80 | ((codePoint >> 12) & 0x3F));
+	output[2] = (uint8)(0x80 | ((codePoint >> 6) & 0x3F));
+	output[3] = (uint8)(0x80 | (codePoint & 0x3F));
+	return 4;
+}
+
+/**
+ * Converts the string to UTF-16 in host byte order. The string is validated
+ * with the same code as String_IsUTF8 first, so decoding needs no checks.
+ *
+ * @param output Receives the code units; room for self->Length units is
+ * always enough
+ * @param written Receives the number of code units written
+ * @returns false, writing nothing, if the string is not valid UTF-8
+ */
+boolean String_ToUTF16(String* self, uint16* output, uint64* written) {
+	uint8* bytes;
+	uint64 length;
+	uint64 i;
+	uint64 o;
+	uint64 count;
+	uint32 codePoint;
+
+	assert(self != NULL);
+	assert(output != NULL || self->Length == 0);
+	assert(written != NULL);
+
+	bytes = String_GetData(self);
+	length = self->Length;
+
+	if (!String_IsUTF8Bytes(bytes, length))
+		return false;
+
+	for (i = 0, o = 0; i < length; ) {
+		if (bytes[i] < 0x80) {
+			count = widenASCII16Kernel(bytes + i, length - i, output + o);
+			i += count;
+			o += count;
+
+			for (; i < length && bytes[i] < 0x80; i++)
+				output[o++] = bytes[i];
+
+			if (i == length)
+				break;
+		}
+
+		codePoint = String_DecodeValidUTF8(bytes, &i);
+
+		if (codePoint < 0x10000) {
+			output[o++] = (uint16)codePoint;
+		}
+		else {
+			codePoint -= 0x10000;
+			output[o++] = (uint16)(0xD800 | (codePoint >> 10));
+			output[o++] = (uint16)(0xDC00 | (codePoint & 0x3FF));
+		}
+	}
+
+	*written = o;
+
+	return true;
+}
+
+/**
+ * Converts the string to UTF-32 in host byte order, as String_ToUTF16 does.
+ *
+ * @param output Receives the code points; room for self->Length of them is
+ * always enough
+ */
+boolean String_ToUTF32(String* self, uint32* output, uint64* written) {
+	uint8* bytes;
+	uint64 length;
+	uint64 i;
+	uint64 o;
+	uint64 count;
+
+	assert(self != NULL);
+	assert(output != NULL || self->Length == 0);
+	assert(written != NULL);
+
+	bytes = String_GetData(self);
+	length = self->Length;
+
+	if (!String_IsUTF8Bytes(bytes, length))
+		return false;
+
+	for (i = 0, o = 0; i < length; ) {
+		if (bytes[i] < 0x80) {
+			count = widenASCII32Kernel(bytes + i, length - i, output + o);
+			i += count;
+			o += count;
+
+			for (; i < length && bytes[i] < 0x80; i++)
+				output[o++] = bytes[i];
+
+			if (i == length)
+				break;
+		}
+
+		output[o++] = String_DecodeValidUTF8(bytes, &i);
+	}
+
+	*written = o;
+
+	return true;
+}
+
+/**
+ * Appends UTF-16 text in host byte order, converted to UTF-8.
+ *
+ * @returns false, leaving the string unchanged, if @a input contains an
+ * unpaired surrogate
+ */
+boolean String_FromUTF16(String* self, uint16* input, uint64 count) {
+	uint8* output;
+	uint64 i;
+	uint64 o;
+	uint64 ascii;
+	uint32 codePoint;
+
+	assert(self != NULL);
+	assert(input != NULL || count == 0);
+
+	output = String_Extend(self, count * 3); /* a surrogate pair is two units and four bytes, any other unit at most three bytes */
+
+	for (i = 0, o = 0; i < count; ) {
+		if (input[i] < 0x80) {
+			ascii = narrowASCII16Kernel(input + i, count - i, output + o);
+			i += ascii;
+			o += ascii;
+
+			for (; i < count && input[i] < 0x80; i++)
+				output[o++] = (uint8)input[i];
+
+			if (i == count)
+				break;
+		}
+
+		codePoint = input[i++];
+
+		if (codePoint >= 0xD800 && codePoint <= 0xDFFF) {
+			if (codePoint >= 0xDC00 || i == count || input[i] < 0xDC00 || input[i] > 0xDFFF) {
+				output[0] = '\0';
+				return false;
+			}
+
+			codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (input[i++] - 0xDC00);
+		}
+
+		o += String_EncodeUTF8(codePoint, output + o);
+	}
+
+	output[o] = '\0';
+	self->Length += o;
+
+	return true;
+}
+
+/**
+ * Appends UTF-32 text in host byte order, converted to UTF-8.
+ *
+ * @returns false, leaving the string unchanged, if @a input contains a
+ * surrogate or a value above U+10FFFF
+ */
+boolean String_FromUTF32(String* self, uint32* input, uint64 count) {
+	uint8* output;
+	uint64 i;
+	uint64 o;
+	uint64 ascii;
+
+	assert(self != NULL);
+	assert(input != NULL || count == 0);
+
+	output = String_Extend(self, count * 4);
+
+	for (i = 0, o = 0; i < count; ) {
+		if (input[i] < 0x80) {
+			ascii = narrowASCII32Kernel(input + i, count - i, output + o);
+			i += ascii;
+			o += ascii;
+
+			for (; i < count && input[i] < 0x80; i++)
+				output[o++] = (uint8)input[i];
+
+			if (i == count)
+				break;
+		}
+
+		if (input[i] > 0x10FFFF || (input[i] >= 0xD800 && input[i] <= 0xDFFF)) {
+			output[0] = '\0';
+			return false;
+		}
+
+		o += String_EncodeUTF8(input[i++], output + o);
+	}
+
+	output[o] = '\0';
+	self->Length += o;
 
 	return true;
 }
@@ -4,22 +4,149 @@
 #include "Common.h"
 #include "Array.h"
 
+#define STRING_INLINE_CAPACITY 22
+
+/**
+ * A byte string of up to 2^64 - 1 bytes. Strings of up to
+ * STRING_INLINE_CAPACITY bytes are stored inside the struct itself; longer
+ * ones move to the heap. The bytes are always followed by a terminating zero.
+ * Use String_GetData rather than reading Storage directly.
+ */
 typedef struct {
-	Array Data;
-	uint16 Length;
+	uint64 Length;
+	uint64 Hash; /* cached by String_Hash, 0 until computed */
+	union {
+		struct {
+			uint8* Data;
+			uint64 Allocation;
+			uint8 Reserved[STRING_INLINE_CAPACITY + 1 - sizeof(uint8*) - sizeof(uint64)];
+			boolean IsHeap;
+		} Heap;
+		struct {
+			uint8 Data[STRING_INLINE_CAPACITY + 1];
+			boolean IsHeap; /* shares its position with Heap.IsHeap */
+		} Inline;
+	} Storage;
 } String;
 
+/* State carried between chunks when validating a UTF-8 stream piece by piece. */
+typedef struct {
+	uint8 Remaining; /* continuation bytes still expected */
+	uint8 Lower; /* range the next continuation byte must fall in */
+	uint8 Upper;
+	boolean Invalid;
+} String_UTF8Validator;
+
+#define STRING_NOT_FOUND 0xFFFFFFFFFFFFFFFFULL
+
+/* A set of bytes prepared for String_FindAny and String_Tokenizer. */
+typedef struct {
+	uint8 LowNibbles[16]; /* bit h of entry l is set if byte 0xhl is in the set, for ASCII bytes */
+	uint32 Bitmap[8];
+	boolean IsASCII;
+} String_ByteSet;
+
+/* Walks the tokens of a text, where tokens are separated by runs of delimiter bytes. */
+typedef struct {
+	ArrayView Remaining;
+	String_ByteSet Delimiters;
+} String_Tokenizer;
+
+/* The canonical copy of an interned string. Two handles from the same table are equal exactly when the pointers are. */
+typedef struct {
+	uint64 Hash;
+	uint64 Length;
+	uint8 Data[1]; /* Length bytes, allocated inline */
+} String_Interned;
+
+typedef struct String_InternSlots String_InternSlots;
+
+/**
+ * Maps byte sequences to their canonical String_Interned copy. Lookups of
+ * strings already present take no lock; inserts are serialized. Handles stay
+ * valid until the table is freed.
+ */
+typedef struct {
+	Memory_Arena Storage;
+	String_InternSlots* volatile Slots;
+	uint64 Count;
+	uint64 Bytes;
+	volatile uint64 Lookups;
+	volatile uint64 Hits;
+	volatile uint64 BytesSaved;
+	volatile int32 Lock;
+} String_InternTable;
+
+typedef struct {
+	uint64 Count; /* distinct strings stored */
+	uint64 Bytes; /* bytes of string data stored */
+	uint64 Lookups;
+	uint64 Hits; /* lookups that found an existing copy */
+	uint64 BytesSaved; /* bytes that callers would have stored without interning */
+	float64 HitRate;
+} String_InternStats;
+
 
-export String* String_New(uint16 size);
+export String* String_New(uint64 capacity);
 export String* String_NewFromCString(int8* cString);
-export void String_Initialize(String* string, uint16 size);
+export void String_Initialize(String* string, uint64 capacity);
 export void String_Free(String* self);
 export void String_Uninitialize(String* self);
 
+export void String_Reserve(String* self, uint64 capacity);
+export void String_Clear(String* self);
+
 export void String_AppendCString(String* self, int8* cString);
-export void String_AppendBytes(String* self, int8* bytes, uint16 size);
+export void String_AppendBytes(String* self, int8* bytes, uint64 size);
 export void String_AppendString(String* self, String* source);
+export void String_AppendView(String* self, ArrayView view);
+export ArrayView String_View(String* self);
+
+export void String_AppendInt64(String* self, int64 value);
+export void String_AppendUInt64(String* self, uint64 value);
+export void String_AppendFloat64(String* self, float64 value);
+export uint64 String_ParseInt64(ArrayView text, int64* value);
+export uint64 String_ParseUInt64(ArrayView text, uint64* value);
+export uint64 String_ParseFloat64(ArrayView text, float64* value);
+
+export uint64 String_HashBytes(uint8* bytes, uint64 length);
+export uint64 String_Hash(String* self);
+export boolean String_Equals(String* a, String* b);
+
+export uint64 String_Find(String* self, uint64 start, ArrayView needle);
+export uint64 String_FindAny(String* self, uint64 start, ArrayView bytes);
+export uint64 String_Split(String* self, ArrayView separator, ArrayView* parts, uint64 maxParts);
+
+export void String_ByteSet_Initialize(String_ByteSet* set, ArrayView bytes);
+export uint64 String_ByteSet_Find(String_ByteSet* self, uint8* bytes, uint64 length);
+
+export void String_Tokenizer_Initialize(String_Tokenizer* tokenizer, ArrayView text, ArrayView delimiters);
+export boolean String_Tokenizer_Next(String_Tokenizer* self, ArrayView* token);
 
 export boolean String_IsUTF8(String* self);
+export boolean String_IsUTF8Bytes(uint8* bytes, uint64 length);
+
+export String_InternTable* String_InternTable_New(void);
+export void String_InternTable_Initialize(String_InternTable* table);
+export void String_InternTable_Free(String_InternTable* self);
+export void String_InternTable_Uninitialize(String_InternTable* self);
+export String_InternStats String_InternTable_GetStats(String_InternTable* self);
+
+export String_Interned* String_Intern(String_InternTable* table, String* string);
+export String_Interned* String_InternBytes(String_InternTable* table, uint8* bytes, uint64 length);
+export ArrayView String_Interned_View(String_Interned* self);
+
+export boolean String_ToUTF16(String* self, uint16* output, uint64* written);
+export boolean String_ToUTF32(String* self, uint32* output, uint64* written);
+export boolean String_FromUTF16(String* self, uint16* input, uint64 count);
+export boolean String_FromUTF32(String* self, uint32* input, uint64 count);
+
+export void String_UTF8Validator_Initialize(String_UTF8Validator* validator);
+export boolean String_UTF8Validator_Update(String_UTF8Validator* self, uint8* bytes, uint64 length);
+export boolean String_UTF8Validator_Finish(String_UTF8Validator* self);
+
+static inline uint8* String_GetData(String* self) {
+	return self->Storage.Inline.IsHeap ? self->Storage.Heap.Data : self->Storage.Inline.Data;
+}
 
 #endif
@@ -25,7 +25,7 @@ static void ClientReadCallback(SAL_Socket* socket, void* state) {
 			client->ReceiveCallback(client, client->State, client->Buffer + MESSAGE_LENGTHBYTES, messageLength);
 			
 			if (excess > 0) {
-				Memory_BlockCopy(client->Buffer + client->BytesReceived - excess, client->Buffer, excess);
+				Memory_Move(client->Buffer + client->BytesReceived - excess, client->Buffer, excess);
 				client->BytesReceived = excess;
 				if (excess > MESSAGE_LENGTHBYTES) {
 					messageLength = *(uint16*)client->Buffer;
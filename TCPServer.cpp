@@ -5,6 +5,8 @@
 #include "DataStream.h"
 #include <SAL/Cryptography.h>
 
+#include <stdlib.h>
+
 #define WS_HEADER_LINES 25
 #define WS_MASK_BYTES 4
 #define WS_CLOSE_OPCODE 0x8
@@ -23,8 +25,9 @@ static void TCPServer_WebSocket_DoHandshake(TCPServer_Client* client, SAL_Socket
     int32 i;
     int32 lastOffset;
     int32 nextHeaderLine;
-    Array* headerLines[WS_HEADER_LINES];
-    Array* keyAndMagic;
+    uint8* lineEnd;
+    ArrayView headerLines[WS_HEADER_LINES];
+    uint8 keyAndMagic[60];
     DataStream* response;
     uint8* hash;
     int8* base64;
@@ -38,22 +41,22 @@ static void TCPServer_WebSocket_DoHandshake(TCPServer_Client* client, SAL_Socket
         return;
     }
 
-    for (i = 0, lastOffset = 0, nextHeaderLine = 0; i < client->BytesReceived && nextHeaderLine < WS_HEADER_LINES; i++) {
-        if (client->Buffer[i] == 13 && client->Buffer[i + 1] == 10) {
-            headerLines[nextHeaderLine] = Array_NewFromExisting(client->Buffer + lastOffset, i - lastOffset);
-            nextHeaderLine++;
-            lastOffset = i + 2;
-        }
+    for (lastOffset = 0, nextHeaderLine = 0; nextHeaderLine < WS_HEADER_LINES; nextHeaderLine++) {
+        lineEnd = Memory_FindBytes(client->Buffer + lastOffset, client->BytesReceived - lastOffset, (uint8*)"\r\n", 2);
+        if (lineEnd == NULL)
+            break;
+
+        i = (int32)(lineEnd - client->Buffer);
+        headerLines[nextHeaderLine] = ArrayView_FromBytes(client->Buffer + lastOffset, i - lastOffset);
+        lastOffset = i + 2;
     }
     
-    keyAndMagic = Array_New(60);
+    Memory_BlockCopy((uint8*)"258EAFA5-E914-47DA-95CA-C5AB0DC85B11", keyAndMagic + 24, 36);
     for (i = 0; i < nextHeaderLine; i++)
-        if (headerLines[i] != NULL)
-            if (headerLines[i]->Size >= 17 && Memory_Compare((uint8*)"Sec-WebSocket-Key", headerLines[i]->Data, 17, 17))
-                keyAndMagic = Array_NewFromExisting(headerLines[i]->Data + 19, 24);
+        if (headerLines[i].Size >= 19 + 24 && Memory_Compare((uint8*)"Sec-WebSocket-Key", headerLines[i].Data, 17, 17))
+            Memory_BlockCopy(headerLines[i].Data + 19, keyAndMagic, 24);
     
-    Array_Write(keyAndMagic, (uint8*)"258EAFA5-E914-47DA-95CA-C5AB0DC85B11", 24, 36);
-    hash = SAL_Cryptography_SHA1(keyAndMagic->Data, 60);
+    hash = SAL_Cryptography_SHA1(keyAndMagic, 60);
     Base64Encode(hash, 20, &base64, &base64Length);
 
     response = DataStream_New(97 + 4 + base64Length);
@@ -69,13 +72,8 @@ static void TCPServer_WebSocket_DoHandshake(TCPServer_Client* client, SAL_Socket
     client->BytesReceived = 0;
     
     DataStream_Free(response);
-    Array_Free(keyAndMagic);
     Free(base64);
-    Free(hash);
-    
-    for (i = 0; i < nextHeaderLine; i++)
-        if (headerLines[i] != NULL)
-            Array_Free(headerLines[i]);
+    free(hash); /* allocated by SAL, not through Memory_Allocate */
 }
 
 static void TCPServer_WebSocket_OnReceive(TCPServer_Client* client, SAL_Socket* socket) {
@@ -92,6 +90,7 @@ static void TCPServer_WebSocket_OnReceive(TCPServer_Client* client, SAL_Socket*
     uint8 headerEnd;
     uint8 maskBuffer[WS_MASK_BYTES];
     uint8* payloadBuffer;
+    DataStream header;
     uint8* dataBuffer; //used for websocket's framing. The unmasked data from the current frame is copied to the start of Client.Buffer. Client.MessageLength is then used to point to the end of the data copied to the start of Client.Buffer.
 
     if (client->WebSocketReady == false) {
@@ -133,7 +132,11 @@ static void TCPServer_WebSocket_OnReceive(TCPServer_Client* client, SAL_Socket*
             if (length == 126) {
                 if (client->BytesReceived < 4)
                     return;
-                length = SAL_Socket_NetworkToHostShort((uint16)*dataBuffer + 2);
+                DataStream_InitializeWrapped(&header, dataBuffer, 4);
+                DataStream_SetByteOrder(&header, DATASTREAM_BYTEORDER_BIG);
+                DataStream_Seek(&header, 2);
+                length = DataStream_ReadUInt16(&header);
+                DataStream_Uninitialize(&header);
                 headerEnd += 2;
             }
             else if (length == 127) { //we don't support messages this big
@@ -183,14 +186,14 @@ static void TCPServer_WebSocket_OnReceive(TCPServer_Client* client, SAL_Socket*
                         if (*(uint16*)client->Buffer == client->MessageLength + length - MESSAGE_LENGTHBYTES) {
                             client->Server->ReceiveCallback(client, client->State, client->Buffer + MESSAGE_LENGTHBYTES, client->MessageLength + length - MESSAGE_LENGTHBYTES);
                         }
-                        Memory_BlockCopy(client->Buffer + length + headerEnd, client->Buffer, client->BytesReceived);
+                        Memory_Move(client->Buffer + length + headerEnd, client->Buffer, client->BytesReceived);
                         dataBuffer = client->Buffer;
                         client->MessageLength = 0;
                     }
                     else {
                         client->MessageLength += length;
                         dataBuffer = client->Buffer + client->MessageLength;
-                        Memory_BlockCopy(payloadBuffer + length, dataBuffer, client->BytesReceived);
+                        Memory_Move(payloadBuffer + length, dataBuffer, client->BytesReceived);
                     }
                     continue;
                 default:
@@ -274,7 +277,7 @@ static void TCPServer_ClientSocketReadCallback(SAL_Socket* socket, void* state)
             server->ReceiveCallback(client, client->State, client->Buffer + MESSAGE_LENGTHBYTES, messageLength);
             
             if (excess > 0) {
-                Memory_BlockCopy(client->Buffer + client->BytesReceived - excess, client->Buffer, excess);
+                Memory_Move(client->Buffer + client->BytesReceived - excess, client->Buffer, excess);
                 client->BytesReceived = excess;
                 if (excess > MESSAGE_LENGTHBYTES) {
                     messageLength = *(uint16*)client->Buffer;
@@ -306,7 +309,7 @@ static SAL_Thread_Start(TCPServer_AcceptWorkerRun) {
         acceptedSocket = SAL_Socket_Accept(server->Listener);
 
         if (acceptedSocket) {
-            newClient = Allocate(TCPServer_Client);
+            newClient = AllocateArrayAligned(TCPServer_Client, 1, MEMORY_CACHELINE);
             newClient->Server = server;
             newClient->State = server->ConnectCallback(newClient, acceptedSocket->RemoteEndpointAddress);
             newClient->Socket = acceptedSocket;
@@ -379,7 +382,7 @@ void TCPServer_DisconnectClient(TCPServer_Client* client) {
     SAL_Socket_Close(client->Socket);
     AsyncLinkedList_Remove(&client->Server->ClientList, client);
 
-    Free(client);
+    FreeAligned(client);
 }
 
 void TCPServer_Shutdown(TCPServer* server) {
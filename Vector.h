@@ -0,0 +1,77 @@
+#ifndef INCLUDE_UTILITIES_VECTOR
+#define INCLUDE_UTILITIES_VECTOR
+
+#include "Common.h"
+
+#define VECTOR_MINIMUM_CAPACITY 8
+
+/**
+ * Defines @a name, a growable array of @a type stored contiguously by value, and
+ * its functions. They are static inline so that pushes and element access
+ * compile down to a bounds check and a store or load.
+ *
+ * name_Initialize(name* vector, uint64 capacity)
+ * name_Uninitialize(name* self)
+ * name_Reserve(name* self, uint64 capacity)
+ * name_Push(name* self, type value)
+ * name_Pop(name* self) - the vector must not be empty
+ * name_At(name* self, uint64 index) - index must be less than Count
+ * name_Clear(name* self)
+ */
+#define TYPED_VECTOR(name, type) \
+	typedef struct { \
+		type* Data; \
+		uint64 Count; \
+		uint64 Capacity; \
+	} name; \
+	\
+	static inline void name##_Initialize(name* vector, uint64 capacity) { \
+		assert(vector != NULL); \
+		vector->Data = capacity ? AllocateArray(type, capacity) : NULL; \
+		vector->Count = 0; \
+		vector->Capacity = capacity; \
+	} \
+	\
+	static inline void name##_Uninitialize(name* self) { \
+		assert(self != NULL); \
+		Free(self->Data); \
+		self->Data = NULL; \
+		self->Count = 0; \
+		self->Capacity = 0; \
+	} \
+	\
+	static inline void name##_Reserve(name* self, uint64 capacity) { \
+		uint64 newCapacity; \
+		assert(self != NULL); \
+		if (capacity <= self->Capacity) \
+			return; \
+		newCapacity = self->Capacity ? self->Capacity * 2 : VECTOR_MINIMUM_CAPACITY; \
+		while (newCapacity < capacity) \
+			newCapacity *= 2; \
+		self->Data = ReallocateArray(type, newCapacity, self->Data); \
+		self->Capacity = newCapacity; \
+	} \
+	\
+	static inline void name##_Push(name* self, type value) { \
+		if (self->Count == self->Capacity) \
+			name##_Reserve(self, self->Count + 1); \
+		self->Data[self->Count++] = value; \
+	} \
+	\
+	static inline type name##_Pop(name* self) { \
+		assert(self->Count > 0); \
+		return self->Data[--self->Count]; \
+	} \
+	\
+	static inline type name##_At(name* self, uint64 index) { \
+		assert(index < self->Count); \
+		return self->Data[index]; \
+	} \
+	\
+	static inline void name##_Clear(name* self) { \
+		self->Count = 0; \
+	}
+
+TYPED_VECTOR(PointerVector, void*)
+
+#endif